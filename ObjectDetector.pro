@@ -1,6 +1,10 @@
 QT       += core gui
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 CONFIG += c++17
+
+# Keep multiply and add separate so the SIMD preprocessing kernels stay
+# bit-exact with their scalar reference
+gcc|clang: QMAKE_CXXFLAGS += -ffp-contract=off
 DEFINES += PROJECT_PATH=\"$$PWD\"
 
 # You can make your code fail to compile if it uses deprecated APIs.
@@ -8,17 +12,53 @@ DEFINES += PROJECT_PATH=\"$$PWD\"
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
 SOURCES += \
+    appsinkpuller.cpp \
+    cpufeatures.cpp \
     detectionworker.cpp \
+    detectorbackend.cpp \
+    eventrecorder.cpp \
+    framering.cpp \
     gstreamerrtsp.cpp \
+    latencycontroller.cpp \
+    latencystats.cpp \
+    modelregistry.cpp \
+    motiongate.cpp \
+    nms.cpp \
+    preprocessor.cpp \
+    preprocesskernels.cpp \
     main.cpp \
     mainwindow.cpp \
-    videoreader.cpp
+    streammanager.cpp \
+    tiling.cpp \
+    tracker.cpp \
+    videoframe.cpp \
+    videoreader.cpp \
+    yolodecoder.cpp
 
 HEADERS += \
+    appsinkpuller.h \
+    cpufeatures.h \
+    detectionresult.h \
     detectionworker.h \
+    detectorbackend.h \
+    eventrecorder.h \
+    framering.h \
+    frametiming.h \
     gstreamerrtsp.h \
+    latencycontroller.h \
+    latencystats.h \
+    modelregistry.h \
+    motiongate.h \
+    nms.h \
+    preprocessor.h \
+    preprocesskernels.h \
     mainwindow.h \
-    videoreader.h
+    streammanager.h \
+    tiling.h \
+    tracker.h \
+    videoframe.h \
+    videoreader.h \
+    yolodecoder.h
 
 FORMS += \
     mainwindow.ui
@@ -0,0 +1,55 @@
+#include "appsinkpuller.h"
+#include <QDebug>
+#include <utility>
+
+AppSinkPuller::AppSinkPuller(GstElement *sink, Handler handler, QObject *parent)
+    : QThread(parent)
+    , m_sink(GST_ELEMENT(gst_object_ref(sink)))
+    , m_handler(std::move(handler)) {
+}
+
+AppSinkPuller::~AppSinkPuller() {
+    stop();
+    gst_object_unref(m_sink);
+}
+
+void AppSinkPuller::stop() {
+    m_stop.store(true, std::memory_order_release);
+    wait();
+}
+
+quint64 AppSinkPuller::samples() const {
+    return m_samples.load(std::memory_order_relaxed);
+}
+
+quint64 AppSinkPuller::batches() const {
+    return m_batches.load(std::memory_order_relaxed);
+}
+
+void AppSinkPuller::run() {
+    GstAppSink *sink = GST_APP_SINK(m_sink);
+
+    while (!m_stop.load(std::memory_order_acquire)) {
+        GstSample *sample = gst_app_sink_try_pull_sample(sink, PULL_TIMEOUT_MS * GST_MSECOND);
+        if (!sample) {
+            // Outside PAUSED/PLAYING the pull returns at once; do not spin
+            if (gst_app_sink_is_eos(sink)) {
+                msleep(PULL_TIMEOUT_MS);
+            }
+            continue;
+        }
+
+        // Then whatever queued up meanwhile, without waiting again
+        int count = 0;
+        do {
+            m_handler(sample);
+            gst_sample_unref(sample);
+            ++count;
+        } while (count < MAX_BATCH && (sample = gst_app_sink_try_pull_sample(sink, 0)));
+
+        m_samples.fetch_add(count, std::memory_order_relaxed);
+        m_batches.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    qDebug() << "Appsink puller stopped after" << samples() << "samples in" << batches() << "batches";
+}
@@ -0,0 +1,45 @@
+#ifndef APPSINKPULLER_H
+#define APPSINKPULLER_H
+
+#include <QThread>
+#include <atomic>
+#include <functional>
+#include <gst/gst.h>
+#include <gst/app/gstappsink.h>
+
+// Drains one appsink from a dedicated thread (pull mode, emit-signals=FALSE).
+// The streaming thread only queues the buffer inside the appsink and goes
+// back to depayloading; mapping, timing and the handoff to consumers happen
+// here. Samples that queued up while one was handled are taken in the same
+// wake-up.
+class AppSinkPuller : public QThread
+{
+    Q_OBJECT
+
+public:
+    static constexpr int PULL_TIMEOUT_MS = 100;     // Bounds how long stop() waits
+    static constexpr int MAX_BATCH = 4;             // Also the appsink max-buffers in pull mode
+
+    using Handler = std::function<void(GstSample *sample)>;
+
+    AppSinkPuller(GstElement *sink, Handler handler, QObject *parent = nullptr);
+    ~AppSinkPuller() override;
+
+    void stop();   // Returns once the thread has exited
+
+    quint64 samples() const;
+    quint64 batches() const;
+
+protected:
+    void run() override;
+
+private:
+    GstElement *m_sink;
+    Handler m_handler;
+
+    std::atomic<bool> m_stop{false};
+    std::atomic<quint64> m_samples{0};
+    std::atomic<quint64> m_batches{0};
+};
+
+#endif // APPSINKPULLER_H
@@ -0,0 +1,75 @@
+# Offline RTSP ingest + detection benchmark. Serves N streams from a local
+# gst-rtsp-server and runs the same StreamManager pipeline as the app.
+QT       += core gui
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+# Keep multiply and add separate so the SIMD preprocessing kernels stay
+# bit-exact with their scalar reference
+gcc|clang: QMAKE_CXXFLAGS += -ffp-contract=off
+TARGET = ObjectDetectorBenchmark
+DEFINES += PROJECT_PATH=\"$$PWD/..\"
+INCLUDEPATH += $$PWD/..
+
+SOURCES += \
+    loadgenerator.cpp \
+    main.cpp \
+    modelcomparison.cpp \
+    ../appsinkpuller.cpp \
+    ../cpufeatures.cpp \
+    ../detectionworker.cpp \
+    ../detectorbackend.cpp \
+    ../eventrecorder.cpp \
+    ../framering.cpp \
+    ../gstreamerrtsp.cpp \
+    ../latencycontroller.cpp \
+    ../latencystats.cpp \
+    ../modelregistry.cpp \
+    ../motiongate.cpp \
+    ../nms.cpp \
+    ../preprocessor.cpp \
+    ../preprocesskernels.cpp \
+    ../streammanager.cpp \
+    ../tiling.cpp \
+    ../tracker.cpp \
+    ../videoframe.cpp \
+    ../yolodecoder.cpp
+
+HEADERS += \
+    loadgenerator.h \
+    modelcomparison.h \
+    ../appsinkpuller.h \
+    ../cpufeatures.h \
+    ../detectionresult.h \
+    ../detectionworker.h \
+    ../detectorbackend.h \
+    ../eventrecorder.h \
+    ../framering.h \
+    ../frametiming.h \
+    ../gstreamerrtsp.h \
+    ../latencycontroller.h \
+    ../latencystats.h \
+    ../modelregistry.h \
+    ../motiongate.h \
+    ../nms.h \
+    ../preprocessor.h \
+    ../preprocesskernels.h \
+    ../streammanager.h \
+    ../tiling.h \
+    ../tracker.h \
+    ../videoframe.h \
+    ../yolodecoder.h
+
+RESOURCES += \
+    ../resources.qrc
+
+unix:!macx:!ios:!android {
+    INCLUDEPATH += /usr/local/include/opencv4
+    INCLUDEPATH += /usr/include/opencv4
+    LIBS += -lopencv_core -lopencv_dnn -lopencv_imgproc
+
+    INCLUDEPATH += /usr/include/gstreamer-1.0
+    INCLUDEPATH += /usr/include/glib-2.0
+    INCLUDEPATH += /usr/lib/x86_64-linux-gnu/glib-2.0/include
+    LIBS += -lgstreamer-1.0 -lgobject-2.0 -lglib-2.0 -lgstbase-1.0 -lgstvideo-1.0 -lgstapp-1.0 -lgstnet-1.0 -lgstrtspserver-1.0
+}
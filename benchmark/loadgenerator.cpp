@@ -0,0 +1,132 @@
+#include "loadgenerator.h"
+#include <QDebug>
+#include <QFileInfo>
+
+LoadGenerator::LoadGenerator(const Config &config)
+    : m_config(config) {
+}
+
+LoadGenerator::~LoadGenerator() {
+    stop();
+}
+
+QString LoadGenerator::encoderElement() const {
+    int kf = m_config.keyframeInterval;
+    bool h265 = m_config.codec == "h265";
+
+    // Prefer the fastest encoder that is installed
+    if (h265) {
+        if (GstElementFactory *f = gst_element_factory_find("x265enc")) {
+            gst_object_unref(f);
+            return QString("x265enc tune=zerolatency speed-preset=ultrafast key-int-max=%1 ! h265parse ! rtph265pay name=pay0 pt=96 config-interval=-1").arg(kf);
+        }
+        return QString();
+    }
+
+    if (GstElementFactory *f = gst_element_factory_find("x264enc")) {
+        gst_object_unref(f);
+        return QString("x264enc tune=zerolatency speed-preset=ultrafast key-int-max=%1 ! h264parse ! rtph264pay name=pay0 pt=96 config-interval=-1").arg(kf);
+    }
+    if (GstElementFactory *f = gst_element_factory_find("openh264enc")) {
+        gst_object_unref(f);
+        return QString("openh264enc complexity=0 gop-size=%1 ! h264parse ! rtph264pay name=pay0 pt=96 config-interval=-1").arg(kf);
+    }
+    return QString();
+}
+
+QString LoadGenerator::launchLine() const {
+    QString encoder = encoderElement();
+    if (encoder.isEmpty()) {
+        return QString();
+    }
+
+    QString raw = QString("video/x-raw,width=%1,height=%2,framerate=%3/1")
+                      .arg(m_config.width).arg(m_config.height).arg(m_config.fps);
+
+    if (!m_config.file.isEmpty()) {
+        gchar *fileUri = gst_filename_to_uri(QFileInfo(m_config.file).absoluteFilePath().toUtf8().constData(), nullptr);
+        QString uri = QString::fromUtf8(fileUri);
+        g_free(fileUri);
+        return QString("( uridecodebin uri=%1 ! videoconvert ! videoscale ! videorate ! %2 ! %3 )")
+            .arg(uri, raw, encoder);
+    }
+
+    return QString("( videotestsrc is-live=true pattern=ball ! %1 ! videoconvert ! %2 )")
+        .arg(raw, encoder);
+}
+
+bool LoadGenerator::start() {
+    QString launch = launchLine();
+    if (launch.isEmpty()) {
+        qCritical() << "No encoder available for codec" << m_config.codec;
+        return false;
+    }
+
+    m_context = g_main_context_new();
+    m_loop = g_main_loop_new(m_context, FALSE);
+
+    m_server = gst_rtsp_server_new();
+    gst_rtsp_server_set_address(m_server, "127.0.0.1");
+    gst_rtsp_server_set_service(m_server, QByteArray::number(m_config.port).constData());
+
+    GstRTSPMountPoints *mounts = gst_rtsp_server_get_mount_points(m_server);
+    for (int i = 0; i < m_config.streams; ++i) {
+        GstRTSPMediaFactory *factory = gst_rtsp_media_factory_new();
+        gst_rtsp_media_factory_set_launch(factory, launch.toUtf8().constData());
+        gst_rtsp_media_factory_set_shared(factory, TRUE);
+        gst_rtsp_mount_points_add_factory(mounts, QString("/cam%1").arg(i).toUtf8().constData(), factory);
+    }
+    g_object_unref(mounts);
+
+    m_sourceId = gst_rtsp_server_attach(m_server, m_context);
+    if (m_sourceId == 0) {
+        qCritical() << "Failed to bind RTSP server on port" << m_config.port;
+        stop();
+        return false;
+    }
+
+    m_thread = std::thread([this]() {
+        g_main_context_push_thread_default(m_context);
+        g_main_loop_run(m_loop);
+        g_main_context_pop_thread_default(m_context);
+    });
+
+    qDebug() << "Load generator serving" << m_config.streams << m_config.codec << "streams:" << launch;
+    return true;
+}
+
+void LoadGenerator::stop() {
+    if (m_loop) {
+        g_main_loop_quit(m_loop);
+    }
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+    if (m_sourceId) {
+        GSource *source = g_main_context_find_source_by_id(m_context, m_sourceId);
+        if (source) {
+            g_source_destroy(source);
+        }
+        m_sourceId = 0;
+    }
+    if (m_server) {
+        g_object_unref(m_server);
+        m_server = nullptr;
+    }
+    if (m_loop) {
+        g_main_loop_unref(m_loop);
+        m_loop = nullptr;
+    }
+    if (m_context) {
+        g_main_context_unref(m_context);
+        m_context = nullptr;
+    }
+}
+
+QStringList LoadGenerator::urls() const {
+    QStringList list;
+    for (int i = 0; i < m_config.streams; ++i) {
+        list << QString("rtsp://127.0.0.1:%1/cam%2").arg(m_config.port).arg(i);
+    }
+    return list;
+}
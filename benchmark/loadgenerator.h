@@ -0,0 +1,45 @@
+#ifndef LOADGENERATOR_H
+#define LOADGENERATOR_H
+
+#include <QString>
+#include <QStringList>
+#include <thread>
+#include <gst/gst.h>
+#include <gst/rtsp-server/rtsp-server.h>
+
+// Localhost RTSP server publishing N synthetic or file-backed streams at
+// rtsp://127.0.0.1:<port>/cam<i>. Runs its own GLib main loop thread.
+class LoadGenerator
+{
+public:
+    struct Config {
+        int streams = 4;
+        quint16 port = 8554;
+        QString codec = "h264";     // h264 or h265
+        int width = 1280;
+        int height = 720;
+        int fps = 25;
+        int keyframeInterval = 50;
+        QString file;               // Empty for videotestsrc
+    };
+
+    explicit LoadGenerator(const Config &config);
+    ~LoadGenerator();
+
+    bool start();
+    void stop();
+    QStringList urls() const;
+
+private:
+    QString launchLine() const;
+    QString encoderElement() const;
+
+    Config m_config;
+    GstRTSPServer *m_server = nullptr;
+    GMainContext *m_context = nullptr;
+    GMainLoop *m_loop = nullptr;
+    guint m_sourceId = 0;
+    std::thread m_thread;
+};
+
+#endif // LOADGENERATOR_H
@@ -0,0 +1,489 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QProcess>
+#include <QTextStream>
+#include <QTimer>
+#include <QDebug>
+#include <memory>
+#include <sys/resource.h>
+#include "latencystats.h"
+#include "loadgenerator.h"
+#include "modelcomparison.h"
+#include "preprocesskernels.h"
+#include "streammanager.h"
+
+// Offline capacity benchmark: serves N RTSP streams on localhost, points N
+// GStreamerRtsp clients plus the detection pool at them and reports
+// sustained fps, CPU, drops and latency once the warm-up is over.
+
+static double processCpuSeconds() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec
+           + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+struct Snapshot {
+    QList<StreamStats> stats;
+    double cpuSeconds = 0.0;
+    qint64 wallMs = 0;
+};
+
+static Snapshot takeSnapshot(const StreamManager &manager, const QElapsedTimer &clock) {
+    Snapshot snapshot;
+    for (int streamId : manager.streamIds()) {
+        snapshot.stats.append(manager.stats(streamId));
+    }
+    snapshot.cpuSeconds = processCpuSeconds();
+    snapshot.wallMs = clock.elapsed();
+    return snapshot;
+}
+
+struct RunSettings {
+    bool pullMode = false;
+    bool motionGating = true;
+    bool tracking = true;
+    int batch = StreamManager::DEFAULT_MAX_BATCH;
+    int batchDeadlineMs = StreamManager::DEFAULT_BATCH_DEADLINE_MS;
+    int inFlight = StreamManager::DEFAULT_MAX_IN_FLIGHT;
+    int threadsPerWorker = 0;
+    bool letterbox = false;        // Otherwise the model decides
+    QString model;
+    QString precision;             // Empty keeps the model's own
+    QString calibration;
+    Nms::Scope nmsScope = DetectionWorker::DEFAULT_NMS_SCOPE;
+    bool softNms = false;
+    QString recordDir;
+    double latencyBudgetMs = 0.0;  // 0 keeps the model's size at the default rate
+    int maxTiles = 0;              // Tiled inference off
+    int warmupMs = 0;
+    int durationMs = 0;
+};
+
+// Prints the report and returns the sustained detection rate
+static double printReport(const Snapshot &begin, const Snapshot &end, const LatencyStats &latency,
+                          const StreamManager &manager) {
+    QTextStream out(stdout);
+    double seconds = (end.wallMs - begin.wallMs) / 1000.0;
+    if (seconds <= 0.0) {
+        return 0.0;
+    }
+
+    out << QString("\n%1 streams, %2 workers x %3 threads, %4 kernels, %5 s measured\n")
+               .arg(end.stats.size()).arg(manager.workerCount()).arg(manager.threadsPerWorker())
+               .arg(PreprocessKernels::name(PreprocessKernels::active().isa))
+               .arg(seconds, 0, 'f', 1);
+    out << QString("%1 %2 %3 %4 %5 %6 %7 %8 %9 %10 %11\n")
+               .arg("stream", 6).arg("in fps", 8).arg("det fps", 8).arg("dropped", 8)
+               .arg("drop %", 7).arg("skip %", 7).arg("dec skip", 9).arg("saved %", 8).arg("ttff ms", 8)
+               .arg("input", 9).arg("stride", 6);
+
+    double totalIn = 0.0, totalDetected = 0.0;
+    quint64 totalReceived = 0, totalDropped = 0, totalSkipped = 0;
+    int totalClips = 0;
+    quint64 detectedFrames = 0, batchedFrames = 0, batchSizeTotal = 0;
+    double totalInference = 0.0;
+    quint64 reordered = 0;
+    quint64 tiles = 0;
+    for (int i = 0; i < end.stats.size() && i < begin.stats.size(); ++i) {
+        const StreamStats &a = begin.stats[i];
+        const StreamStats &b = end.stats[i];
+        quint64 received = b.framesReceived - a.framesReceived;
+        quint64 dropped = b.framesDropped - a.framesDropped;
+        quint64 skipped = b.framesSkipped - a.framesSkipped;
+        double inFps = received / seconds;
+        double detFps = (b.framesDetected - a.framesDetected) / seconds;
+
+        totalIn += inFps;
+        totalDetected += detFps;
+        totalReceived += received;
+        totalDropped += dropped;
+        totalSkipped += skipped;
+        totalClips += b.clipsRecorded - a.clipsRecorded;
+        detectedFrames += b.framesDetected - a.framesDetected;
+        batchedFrames += b.framesBatched - a.framesBatched;
+        batchSizeTotal += b.batchSizeTotal - a.batchSizeTotal;
+        totalInference += b.inferenceSecondsTotal - a.inferenceSecondsTotal;
+        reordered += b.resultsReordered - a.resultsReordered;
+        tiles += b.tilesInferred - a.tilesInferred;
+
+        quint64 evaluated = b.framesGateEvaluated - a.framesGateEvaluated;
+        double saved = evaluated ? (b.inferencesSavedTotal - a.inferencesSavedTotal) / evaluated : 0.0;
+
+        QString input = b.inputSize.area() > 0 ? QString("%1x%2").arg(b.inputSize.width).arg(b.inputSize.height)
+                                               : QString("model");
+        out << QString("%1 %2 %3 %4 %5 %6 %7 %8 %9 %10 %11\n")
+                   .arg(b.streamId, 6)
+                   .arg(inFps, 8, 'f', 1)
+                   .arg(detFps, 8, 'f', 1)
+                   .arg(dropped, 8)
+                   .arg(received ? 100.0 * dropped / received : 0.0, 7, 'f', 1)
+                   .arg(received ? 100.0 * skipped / received : 0.0, 7, 'f', 1)
+                   .arg(b.decoderSkipped - a.decoderSkipped, 9)
+                   .arg(100.0 * saved, 8, 'f', 1)
+                   .arg(b.timeToFirstFrameMs, 8)
+                   .arg(input, 9)
+                   .arg(b.detectStride, 6);
+    }
+
+    double cpuPercent = 100.0 * (end.cpuSeconds - begin.cpuSeconds) / seconds;
+    int streams = qMax(1, end.stats.size());
+
+    LatencyStats::Percentiles total = latency.endToEnd(FrameTiming::Delivered);
+
+    out << QString("\nsustained input:     %1 fps\n").arg(totalIn, 0, 'f', 1);
+    out << QString("sustained detection: %1 fps\n").arg(totalDetected, 0, 'f', 1);
+    out << QString("drop rate:           %1 %\n")
+               .arg(totalReceived ? 100.0 * totalDropped / totalReceived : 0.0, 0, 'f', 2);
+    out << QString("skip rate:           %1 % (dropped, gated or rate skipped)\n")
+               .arg(totalReceived ? 100.0 * totalSkipped / totalReceived : 0.0, 0, 'f', 2);
+    out << QString("cpu total:           %1 % of one core\n").arg(cpuPercent, 0, 'f', 1);
+    out << QString("cpu per stream:      %1 % of one core\n").arg(cpuPercent / streams, 0, 'f', 1);
+    if (detectedFrames > 0) {
+        if (batchedFrames > 0) {
+            out << QString("avg batch size:      %1%2\n")
+                       .arg(static_cast<double>(batchSizeTotal) / batchedFrames, 0, 'f', 2)
+                       .arg(tiles > 0 ? " (tiled frames excluded)" : "");
+        }
+        out << QString("inference:           %1 ms per frame (amortized over the batch)\n")
+                   .arg(1000.0 * totalInference / detectedFrames, 0, 'f', 2);
+        if (tiles > 0) {
+            out << QString("tiles:               %1 per detected frame, besides the coarse pass\n")
+                       .arg(static_cast<double>(tiles) / detectedFrames, 0, 'f', 2);
+        }
+    }
+    ModelTimings startup = manager.modelTimings();
+    out << QString("cold start:          %1 ms until every worker was ready (read %2 ms, warm-up %3 ms, first pass %4 ms)\n")
+               .arg(manager.modelReadyMs()).arg(startup.readMs).arg(startup.warmupMs)
+               .arg(startup.firstPassMs, 0, 'f', 1);
+    qint64 firstDetection = -1;
+    double firstInference = 0.0;
+    for (const StreamStats &stats : end.stats) {
+        firstDetection = qMax(firstDetection, stats.timeToFirstDetectionMs);
+        firstInference = qMax(firstInference, stats.firstInferenceMs);
+    }
+    if (firstDetection >= 0) {
+        out << QString("first detection:     %1 ms after its stream was added (slowest), first pass %2 ms\n")
+                   .arg(firstDetection).arg(firstInference, 0, 'f', 1);
+    }
+    out << QString("work stealing:       %1 batches stolen, %2 results reordered\n")
+               .arg(manager.stolenBatches()).arg(reordered);
+    if (totalClips > 0) {
+        out << QString("clips recorded:      %1\n").arg(totalClips);
+    }
+    out << QString("latency (source to result, %1 samples): p50 %2 ms, p90 %3 ms, p99 %4 ms, max %5 ms\n")
+               .arg(total.count)
+               .arg(total.p50, 0, 'f', 1)
+               .arg(total.p90, 0, 'f', 1)
+               .arg(total.p99, 0, 'f', 1)
+               .arg(total.max, 0, 'f', 1);
+    out << QString("per stage p50 (ms):  %1\n").arg(latency.summary(FrameTiming::Delivered));
+    out.flush();
+    return totalDetected;
+}
+
+// One measurement with a fresh pool of `workers` detection workers
+static double runMeasurement(const QStringList &urls, const RunSettings &settings, int workers) {
+    auto manager = std::make_unique<StreamManager>(workers);
+    manager->setThreadsPerWorker(settings.threadsPerWorker);
+    manager->setPullMode(settings.pullMode);
+    manager->setBatching(settings.batch, settings.batchDeadlineMs);
+    manager->setMaxInFlight(settings.inFlight);
+    if (!settings.model.isEmpty() || !settings.precision.isEmpty()) {
+        ModelInfo info;
+        ModelRegistry::find(settings.model.isEmpty() ? ModelRegistry::DEFAULT_MODEL : settings.model, info);
+        ModelInfo::parsePrecision(settings.precision, info.precision);
+        if (!settings.calibration.isEmpty()) {
+            info.calibrationPath = settings.calibration;
+        }
+        // Measure the model asked for, not the default one while it loads
+        QEventLoop loaded;
+        QObject::connect(manager.get(), &StreamManager::modelLoaded, &loaded, [&](bool ok) {
+            if (manager->modelReadyMs() < 0) {
+                return;   // The default model, superseded
+            }
+            if (!ok) {
+                qCritical() << "Failed to load model" << info.name;
+            }
+            loaded.quit();
+        });
+        manager->setModel(info);
+        loaded.exec();
+    }
+    if (settings.letterbox) {
+        manager->setLetterbox(true);
+    }
+    manager->setNms(settings.nmsScope, settings.softNms);
+    manager->setRecordingDir(settings.recordDir);
+    for (const QString &url : urls) {
+        int streamId = manager->addStream(url);
+        manager->setMotionGating(streamId, settings.motionGating);
+        manager->setTracking(streamId, settings.tracking);
+        manager->setLatencyBudget(streamId, settings.latencyBudgetMs);
+        manager->setTiling(streamId, settings.maxTiles);
+    }
+
+    QEventLoop loop;
+    QElapsedTimer clock;
+    clock.start();
+    Snapshot begin;
+    LatencyStats latency(LatencyStats::DEFAULT_WINDOW * 64);
+    bool measuring = false;
+    double detectionFps = 0.0;
+
+    QObject::connect(manager.get(), &StreamManager::detectionDone, &loop,
+                     [&](int, const DetectionResult &result) {
+                         if (measuring && result.detected) {
+                             FrameTiming timing = result.timing;
+                             timing.stamps[FrameTiming::Delivered] = VideoFrame::nowNs();
+                             latency.add(timing);
+                         }
+                     });
+
+    QTimer::singleShot(settings.warmupMs, &loop, [&]() {
+        begin = takeSnapshot(*manager, clock);
+        measuring = true;
+    });
+
+    QTimer::singleShot(settings.warmupMs + settings.durationMs, &loop, [&]() {
+        measuring = false;
+        detectionFps = printReport(begin, takeSnapshot(*manager, clock), latency, *manager);
+        loop.quit();
+    });
+
+    loop.exec();
+    return detectionFps;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("ObjectDetectorBenchmark");
+
+    qRegisterMetaType<VideoFrame>("VideoFrame");
+    qRegisterMetaType<DetectionResult>("DetectionResult");
+    qRegisterMetaType<DetectionRequest>("DetectionRequest");
+    qRegisterMetaType<QVector<DetectionRequest>>("QVector<DetectionRequest>");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Offline multi-stream RTSP ingest and detection benchmark");
+    parser.addHelpOption();
+
+    QCommandLineOption streamsOption("streams", "Number of RTSP streams.", "n", "4");
+    QCommandLineOption workersOption("workers", "Detection workers.", "n",
+                                     QString::number(StreamManager::DEFAULT_WORKER_COUNT));
+    QCommandLineOption durationOption("duration", "Measured seconds.", "s", "30");
+    QCommandLineOption warmupOption("warmup", "Seconds before measuring starts.", "s", "5");
+    QCommandLineOption codecOption("codec", "h264 or h265.", "codec", "h264");
+    QCommandLineOption widthOption("width", "Stream width.", "px", "1280");
+    QCommandLineOption heightOption("height", "Stream height.", "px", "720");
+    QCommandLineOption fpsOption("fps", "Stream frame rate.", "fps", "25");
+    QCommandLineOption portOption("port", "RTSP server port.", "port", "8554");
+    QCommandLineOption fileOption("file", "Serve this video file instead of a test pattern.", "path");
+    QCommandLineOption pullOption("pull", "Drain appsinks from puller threads instead of new-sample callbacks.");
+    QCommandLineOption noGateOption("no-motion-gate", "Run inference on every frame, even for static scenes.");
+    QCommandLineOption noTrackingOption("no-tracking", "Reuse the last boxes between detections instead of tracking them.");
+    QCommandLineOption inProcessOption("in-process", "Run the RTSP server inside the benchmark process (its CPU is then included).");
+    QCommandLineOption batchOption("batch", "Frames per forward pass, collected across streams.", "n",
+                                   QString::number(StreamManager::DEFAULT_MAX_BATCH));
+    QCommandLineOption batchDeadlineOption("batch-deadline", "Longest a frame waits for a fuller batch.", "ms",
+                                           QString::number(StreamManager::DEFAULT_BATCH_DEADLINE_MS));
+    QCommandLineOption inFlightOption("in-flight", "Frames per stream inferred concurrently (results are reordered).", "n",
+                                      QString::number(StreamManager::DEFAULT_MAX_IN_FLIGHT));
+    QCommandLineOption threadsOption("threads", "OpenCV threads per worker; 0 splits the cores evenly.", "n", "0");
+    QCommandLineOption scalingOption("scaling", "Measure each comma-separated worker count and print the scaling curve.", "list");
+    QCommandLineOption letterboxOption("letterbox", "Letterbox detector inputs instead of stretching them.");
+    QCommandLineOption modelOption("model", "Registry model to run (see --list-models).", "name");
+    QCommandLineOption listModelsOption("list-models", "Print the registry's models and exit.");
+    QCommandLineOption compareOption("compare-models", "Compare comma-separated models on --clip and exit.", "list");
+    QCommandLineOption clipOption("clip", "Local video for --compare-models.", "path");
+    QCommandLineOption referenceOption("reference", "Model whose boxes count as ground truth (default: first compared).", "name");
+    QCommandLineOption precisionOption("precision", "Inference precision: fp32, fp16 or int8.", "precision");
+    QCommandLineOption precisionsOption("precisions", "Comma-separated precisions for --compare-models.", "list", "fp32");
+    QCommandLineOption calibrationOption("calibration", "Images directory or clip to calibrate INT8 on (default: --clip).", "path");
+    QCommandLineOption framesOption("frames", "Clip frames to compare on.", "n", "200");
+    QCommandLineOption recallOption("recall-target", "Recall the picked model must reach.", "ratio", "0.9");
+    QCommandLineOption nmsOption("nms", "Suppress overlaps per-class or agnostic (across classes).", "scope", "per-class");
+    QCommandLineOption softNmsOption("soft-nms", "Decay overlapping scores (Gaussian Soft-NMS) instead of dropping boxes.");
+    QCommandLineOption latencyBudgetOption("latency-budget", "Adapt input size and detection rate so a pass takes at most this long.", "ms", "0");
+    QCommandLineOption tilesOption("tiles", "Tile large frames: a coarse pass plus up to n native-scale tiles per frame.", "n", "0");
+    QCommandLineOption recordOption("record", "Record detection-triggered clips into this directory.", "dir");
+    QCommandLineOption kernelsOption("kernels", "Preprocessing kernels: scalar, avx2, avx512 or neon (default: best supported).", "isa");
+    QCommandLineOption verifyKernelsOption("verify-kernels", "Check the SIMD preprocessing kernels against the scalar reference and exit.");
+    QCommandLineOption serveOption("serve", "Only run the RTSP server until terminated.");
+    parser.addOptions({ streamsOption, workersOption, durationOption, warmupOption, codecOption,
+                        widthOption, heightOption, fpsOption, portOption, fileOption,
+                        pullOption, noGateOption, noTrackingOption, batchOption, batchDeadlineOption, inFlightOption, threadsOption, scalingOption, letterboxOption, modelOption, listModelsOption, compareOption, clipOption, referenceOption,
+                        precisionOption, precisionsOption, calibrationOption, framesOption, recallOption, nmsOption, softNmsOption, latencyBudgetOption, tilesOption, recordOption, kernelsOption, verifyKernelsOption, inProcessOption, serveOption });
+    parser.process(app);
+
+    if (parser.isSet(verifyKernelsOption)) {
+        QStringList report;
+        bool exact = PreprocessKernels::verify(&report);
+        QTextStream out(stdout);
+        for (const QString &line : report) {
+            out << line << "\n";
+        }
+        return exact ? 0 : 1;
+    }
+    if (parser.isSet(listModelsOption)) {
+        QTextStream out(stdout);
+        for (const ModelInfo &info : ModelRegistry::models()) {
+            out << QString("%1 %2x%3 %4 %5\n").arg(info.name, -16).arg(info.inputSize.width)
+                       .arg(info.inputSize.height).arg(ModelInfo::precisionName(info.precision)).arg(info.modelPath);
+        }
+        return 0;
+    }
+    if (parser.isSet(compareOption)) {
+        ModelComparison::Options options;
+        options.models = parser.value(compareOption).split(',', Qt::SkipEmptyParts);
+        options.reference = parser.value(referenceOption);
+        options.precisions.clear();
+        for (const QString &name : parser.value(precisionsOption).split(',', Qt::SkipEmptyParts)) {
+            ModelInfo::Precision precision;
+            if (!ModelInfo::parsePrecision(name, precision)) {
+                qCritical() << "Unknown precision" << name;
+                return 1;
+            }
+            options.precisions.append(precision);
+        }
+        if (options.precisions.isEmpty()) {
+            options.precisions.append(ModelInfo::Fp32);
+        }
+        options.calibration = parser.value(calibrationOption);
+        options.clip = parser.value(clipOption);
+        options.frames = qMax(1, parser.value(framesOption).toInt());
+        options.recallTarget = parser.value(recallOption).toDouble();
+        options.threads = parser.value(threadsOption).toInt();
+        if (options.clip.isEmpty()) {
+            qCritical() << "--compare-models needs --clip";
+            return 1;
+        }
+        return ModelComparison::run(options);
+    }
+    if (parser.isSet(kernelsOption)) {
+        PreprocessKernels::Isa isa;
+        if (!PreprocessKernels::fromName(parser.value(kernelsOption), isa) || !PreprocessKernels::select(isa)) {
+            qCritical() << "Unsupported preprocessing kernels" << parser.value(kernelsOption);
+            return 1;
+        }
+    }
+
+    if (parser.isSet(precisionOption)) {
+        ModelInfo::Precision precision;
+        if (!ModelInfo::parsePrecision(parser.value(precisionOption), precision)) {
+            qCritical() << "Unknown precision" << parser.value(precisionOption);
+            return 1;
+        }
+    }
+
+    GStreamerRtsp::initializeGStreamer();
+
+    LoadGenerator::Config config;
+    config.streams = qMax(1, parser.value(streamsOption).toInt());
+    config.port = static_cast<quint16>(parser.value(portOption).toUInt());
+    config.codec = parser.value(codecOption);
+    config.width = parser.value(widthOption).toInt();
+    config.height = parser.value(heightOption).toInt();
+    config.fps = parser.value(fpsOption).toInt();
+    config.file = parser.value(fileOption);
+
+    if (parser.isSet(serveOption)) {
+        LoadGenerator generator(config);
+        if (!generator.start()) {
+            return 1;
+        }
+        return app.exec();
+    }
+
+    // By default the server runs in a child process so the encoders do not
+    // count against the client CPU figures
+    std::unique_ptr<LoadGenerator> generator;
+    QProcess server;
+    if (parser.isSet(inProcessOption)) {
+        generator.reset(new LoadGenerator(config));
+        if (!generator->start()) {
+            return 1;
+        }
+    } else {
+        QStringList args = { "--serve",
+                             "--streams", QString::number(config.streams),
+                             "--port", QString::number(config.port),
+                             "--codec", config.codec,
+                             "--width", QString::number(config.width),
+                             "--height", QString::number(config.height),
+                             "--fps", QString::number(config.fps) };
+        if (!config.file.isEmpty()) {
+            args << "--file" << config.file;
+        }
+        server.setProcessChannelMode(QProcess::ForwardedChannels);
+        server.start(QCoreApplication::applicationFilePath(), args);
+        if (!server.waitForStarted()) {
+            qCritical() << "Failed to start RTSP server process";
+            return 1;
+        }
+    }
+
+    RunSettings settings;
+    settings.pullMode = parser.isSet(pullOption);
+    settings.motionGating = !parser.isSet(noGateOption);
+    settings.tracking = !parser.isSet(noTrackingOption);
+    settings.batch = parser.value(batchOption).toInt();
+    settings.batchDeadlineMs = parser.value(batchDeadlineOption).toInt();
+    settings.inFlight = parser.value(inFlightOption).toInt();
+    settings.threadsPerWorker = parser.value(threadsOption).toInt();
+    settings.letterbox = parser.isSet(letterboxOption);
+    settings.model = parser.value(modelOption);
+    settings.precision = parser.value(precisionOption);
+    settings.calibration = parser.value(calibrationOption);
+    settings.nmsScope = parser.value(nmsOption) == "agnostic" ? Nms::ClassAgnostic : Nms::PerClass;
+    settings.softNms = parser.isSet(softNmsOption);
+    settings.recordDir = parser.value(recordOption);
+    settings.latencyBudgetMs = parser.value(latencyBudgetOption).toDouble();
+    settings.maxTiles = parser.value(tilesOption).toInt();
+    settings.warmupMs = parser.value(warmupOption).toInt() * 1000;
+    settings.durationMs = parser.value(durationOption).toInt() * 1000;
+
+    QStringList urls = LoadGenerator(config).urls();
+    QList<int> workerCounts;
+    for (const QString &count : parser.value(scalingOption).split(',', Qt::SkipEmptyParts)) {
+        workerCounts.append(qMax(1, count.toInt()));
+    }
+    if (workerCounts.isEmpty()) {
+        workerCounts.append(parser.value(workersOption).toInt());
+    }
+
+    QList<double> rates;
+    for (int workers : workerCounts) {
+        rates.append(runMeasurement(urls, settings, workers));
+    }
+
+    // Speed-up against the first point, and how much of the ideal linear
+    // speed-up that is
+    if (workerCounts.size() > 1) {
+        QTextStream out(stdout);
+        out << QString("\nscaling (%1 streams)\n").arg(urls.size());
+        out << QString("%1 %2 %3 %4\n").arg("workers", 8).arg("det fps", 9).arg("speedup", 8).arg("effic %", 8);
+        for (int i = 0; i < workerCounts.size(); ++i) {
+            double speedup = rates[0] > 0.0 ? rates[i] / rates[0] : 0.0;
+            double ideal = static_cast<double>(workerCounts[i]) / workerCounts[0];
+            out << QString("%1 %2 %3 %4\n")
+                       .arg(workerCounts[i], 8)
+                       .arg(rates[i], 9, 'f', 1)
+                       .arg(speedup, 8, 'f', 2)
+                       .arg(100.0 * speedup / ideal, 8, 'f', 1);
+        }
+        out.flush();
+    }
+
+    if (server.state() != QProcess::NotRunning) {
+        server.terminate();
+        if (!server.waitForFinished(2000)) {
+            server.kill();
+            server.waitForFinished();
+        }
+    }
+    return 0;
+}
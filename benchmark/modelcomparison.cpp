@@ -0,0 +1,296 @@
+#include "modelcomparison.h"
+#include <QDebug>
+#include <QFile>
+#include <QMap>
+#include <QTextStream>
+#include <algorithm>
+#include <map>
+#include <vector>
+#include <sys/resource.h>
+#include <unistd.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+#include <opencv2/videoio.hpp>
+#include "detectionworker.h"
+
+namespace {
+
+struct ModelRun {
+    ModelInfo info;                                 // As loaded, with the precision actually run
+    ModelInfo::Precision requested = ModelInfo::Fp32;
+    QMap<int, std::vector<Detection>> detections;   // By frame index, detected frames only
+    double seconds = 0.0;                           // Sum of per-frame processing time
+    double residentMb = 0.0;                        // Growth while the variant was loaded
+};
+
+// Current resident set from /proc; elsewhere the peak, which only grows
+double residentMb() {
+    QFile statm("/proc/self/statm");
+    if (statm.open(QIODevice::ReadOnly)) {
+        const QList<QByteArray> fields = statm.readAll().split(' ');
+        if (fields.size() > 1) {
+            return fields[1].toDouble() * sysconf(_SC_PAGESIZE) / (1024.0 * 1024.0);
+        }
+    }
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss / (1024.0 * 1024.0);
+#else
+    return usage.ru_maxrss / 1024.0;
+#endif
+}
+
+bool runModel(const ModelComparison::Options &options, ModelRun &run) {
+    cv::VideoCapture capture(options.clip.toStdString());
+    if (!capture.isOpened()) {
+        qCritical() << "Failed to open clip" << options.clip;
+        return false;
+    }
+
+    // Hand the previous variant's pages back so the growth is this one's
+#ifdef __GLIBC__
+    malloc_trim(0);
+#endif
+    const double residentBefore = residentMb();
+
+    DetectionWorker worker(run.info);
+    worker.setThreadBudget(options.threads);
+    run.info = worker.model();
+    int frameIndex = 0;
+    QObject::connect(&worker, &DetectionWorker::detectionDone, [&](int, const DetectionResult &result) {
+        if (result.detected) {
+            run.detections.insert(frameIndex, result.detections);
+            run.seconds += result.processingTime;
+        }
+    });
+
+    cv::Mat mat;
+    for (; frameIndex < options.frames && capture.read(mat); ++frameIndex) {
+        // The worker runs on this thread, so detectionDone has fired on return
+        worker.detectObject(0, VideoFrame::fromMat(mat.clone()));
+    }
+    run.residentMb = std::max(0.0, residentMb() - residentBefore);
+    if (run.detections.isEmpty()) {
+        qCritical() << "Model" << run.info.name << "produced no results";
+        return false;
+    }
+    return true;
+}
+
+float iou(const cv::Rect2f &a, const cv::Rect2f &b) {
+    float inter = (a & b).area();
+    float unionArea = a.area() + b.area() - inter;
+    return unionArea > 0.0f ? inter / unionArea : 0.0f;
+}
+
+// Greedy one-to-one matching of candidate boxes to reference boxes,
+// strongest candidates first
+int matches(const std::vector<Detection> &reference, std::vector<Detection> candidates, float minIou) {
+    std::sort(candidates.begin(), candidates.end(),
+              [](const Detection &a, const Detection &b) { return a.confidence > b.confidence; });
+    std::vector<bool> used(reference.size(), false);
+    int matched = 0;
+    for (const Detection &candidate : candidates) {
+        int best = -1;
+        float bestIou = minIou;
+        for (size_t r = 0; r < reference.size(); ++r) {
+            if (used[r] || reference[r].label != candidate.label) {
+                continue;
+            }
+            float overlap = iou(reference[r].box, candidate.box);
+            if (overlap >= bestIou) {
+                best = static_cast<int>(r);
+                bestIou = overlap;
+            }
+        }
+        if (best >= 0) {
+            used[best] = true;
+            matched++;
+        }
+    }
+    return matched;
+}
+
+// mAP with the reference's boxes as ground truth: per label, all-point
+// interpolated AP over every frame's candidates ranked by confidence,
+// averaged over the labels the reference found
+double meanAveragePrecision(const ModelRun &reference, const ModelRun &run, float minIou) {
+    struct Ranked {
+        float confidence;
+        bool truePositive;
+    };
+    std::map<std::string, std::vector<Ranked>> ranked;
+    std::map<std::string, int> positives;
+
+    for (auto it = reference.detections.constBegin(); it != reference.detections.constEnd(); ++it) {
+        const std::vector<Detection> &truth = it.value();
+        for (const Detection &detection : truth) {
+            positives[detection.label]++;
+        }
+        std::vector<Detection> candidates = run.detections.value(it.key());
+        std::sort(candidates.begin(), candidates.end(),
+                  [](const Detection &a, const Detection &b) { return a.confidence > b.confidence; });
+        std::vector<bool> used(truth.size(), false);
+        for (const Detection &candidate : candidates) {
+            int best = -1;
+            float bestIou = minIou;
+            for (size_t r = 0; r < truth.size(); ++r) {
+                if (used[r] || truth[r].label != candidate.label) {
+                    continue;
+                }
+                float overlap = iou(truth[r].box, candidate.box);
+                if (overlap >= bestIou) {
+                    best = static_cast<int>(r);
+                    bestIou = overlap;
+                }
+            }
+            if (best >= 0) {
+                used[best] = true;
+            }
+            ranked[candidate.label].push_back({ candidate.confidence, best >= 0 });
+        }
+    }
+
+    double sum = 0.0;
+    for (const auto &label : positives) {
+        std::vector<Ranked> &list = ranked[label.first];
+        std::stable_sort(list.begin(), list.end(),
+                         [](const Ranked &a, const Ranked &b) { return a.confidence > b.confidence; });
+        std::vector<double> recall(list.size()), precision(list.size());
+        int truePositives = 0;
+        for (size_t i = 0; i < list.size(); ++i) {
+            truePositives += list[i].truePositive ? 1 : 0;
+            recall[i] = static_cast<double>(truePositives) / label.second;
+            precision[i] = static_cast<double>(truePositives) / (i + 1);
+        }
+        // Precision envelope, then the area under the stepped curve
+        for (size_t i = list.size(); i-- > 1;) {
+            precision[i - 1] = std::max(precision[i - 1], precision[i]);
+        }
+        double ap = 0.0, previousRecall = 0.0;
+        for (size_t i = 0; i < list.size(); ++i) {
+            ap += (recall[i] - previousRecall) * precision[i];
+            previousRecall = recall[i];
+        }
+        sum += ap;
+    }
+    return positives.empty() ? 1.0 : sum / positives.size();
+}
+
+QString variantName(const ModelRun &run) {
+    QString name = QString("%1/%2").arg(run.info.name, ModelInfo::precisionName(run.info.precision));
+    // Mark variants whose requested precision was not available
+    return run.info.precision == run.requested ? name : name + "*";
+}
+
+} // namespace
+
+int ModelComparison::run(const Options &options) {
+    QStringList names = options.models;
+    const QString reference = options.reference.isEmpty() && !names.isEmpty() ? names.first() : options.reference;
+    if (!names.contains(reference)) {
+        names.prepend(reference);
+    }
+
+    // The reference runs first and in FP32 (unless its file is INT8);
+    // every model then runs at each requested precision
+    QList<ModelRun> runs;
+    auto runVariant = [&](const QString &name, ModelInfo::Precision precision) {
+        ModelRun run;
+        if (!ModelRegistry::find(name, run.info)) {
+            qCritical() << "Unknown model" << name;
+            return false;
+        }
+        if (!run.info.quantized) {
+            run.info.precision = precision;
+        }
+        if (run.info.calibrationPath.isEmpty()) {
+            run.info.calibrationPath = options.calibration.isEmpty() ? options.clip : options.calibration;
+        }
+        run.requested = run.info.precision;
+        if (!runModel(options, run)) {
+            return false;
+        }
+        runs.append(run);
+        return true;
+    };
+    if (!runVariant(reference, ModelInfo::Fp32)) {
+        return 1;
+    }
+    for (const QString &name : names) {
+        ModelInfo info;
+        ModelRegistry::find(name, info);
+        for (ModelInfo::Precision precision : options.precisions) {
+            // An INT8 file only runs as INT8, and only once
+            bool duplicate = info.quantized ? precision != options.precisions.first()
+                                            : name == reference && precision == ModelInfo::Fp32;
+            if (!duplicate && !(name == reference && info.quantized) && !runVariant(name, precision)) {
+                return 1;
+            }
+        }
+    }
+
+    // Reference FP32 detections are the ground truth; a model's mAP delta
+    // is against its own FP32 run
+    const ModelRun &ref = runs.first();
+    QMap<QString, double> fp32Map;
+    bool fellBack = false;
+    for (const ModelRun &run : runs) {
+        if (run.requested == ModelInfo::Fp32 && !fp32Map.contains(run.info.name)) {
+            fp32Map.insert(run.info.name, meanAveragePrecision(ref, run, options.matchIou));
+        }
+        fellBack = fellBack || run.info.precision != run.requested;
+    }
+    QTextStream out(stdout);
+    out << QString("\n%1 frames of %2, reference %3, match IoU %4\n")
+               .arg(options.frames).arg(options.clip, variantName(ref)).arg(options.matchIou, 0, 'f', 2);
+    out << QString("%1 %2 %3 %4 %5 %6 %7 %8 %9\n")
+               .arg("model", -20).arg("input", 9).arg("fps", 8).arg("rss MB", 7).arg("boxes", 7)
+               .arg("recall", 7).arg("precis", 7).arg("mAP", 6).arg("dmAP", 7);
+
+    int cheapest = -1;
+    double cheapestFps = 0.0;
+    for (int i = 0; i < runs.size(); ++i) {
+        const ModelRun &run = runs[i];
+        int refBoxes = 0, boxes = 0, matched = 0;
+        for (auto it = ref.detections.constBegin(); it != ref.detections.constEnd(); ++it) {
+            const std::vector<Detection> own = run.detections.value(it.key());
+            refBoxes += static_cast<int>(it.value().size());
+            boxes += static_cast<int>(own.size());
+            matched += matches(it.value(), own, options.matchIou);
+        }
+        double recall = refBoxes > 0 ? static_cast<double>(matched) / refBoxes : 1.0;
+        double precision = boxes > 0 ? static_cast<double>(matched) / boxes : 1.0;
+        double fps = run.seconds > 0.0 ? run.detections.size() / run.seconds : 0.0;
+        double map = meanAveragePrecision(ref, run, options.matchIou);
+        if (recall >= options.recallTarget && fps > cheapestFps) {
+            cheapest = i;
+            cheapestFps = fps;
+        }
+
+        out << QString("%1 %2 %3 %4 %5 %6 %7 %8 %9\n")
+                   .arg(variantName(run), -20)
+                   .arg(QString("%1x%2").arg(run.info.inputSize.width).arg(run.info.inputSize.height), 9)
+                   .arg(fps, 8, 'f', 1)
+                   .arg(run.residentMb, 7, 'f', 1)
+                   .arg(boxes, 7)
+                   .arg(recall, 7, 'f', 3)
+                   .arg(precision, 7, 'f', 3)
+                   .arg(map, 6, 'f', 3)
+                   .arg(fp32Map.contains(run.info.name)
+                            ? QString("%1").arg(map - fp32Map.value(run.info.name), 7, 'f', 3) : QString("%1").arg("-", 7));
+    }
+
+    if (cheapest >= 0) {
+        out << QString("\nfastest meeting recall %1: %2\n").arg(options.recallTarget, 0, 'f', 2).arg(variantName(runs[cheapest]));
+    } else {
+        out << QString("\nno variant meets recall %1\n").arg(options.recallTarget, 0, 'f', 2);
+    }
+    if (fellBack) {
+        out << "* requested precision not available; ran as shown\n";
+    }
+    out.flush();
+    return 0;
+}
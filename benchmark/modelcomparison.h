@@ -0,0 +1,33 @@
+#ifndef MODELCOMPARISON_H
+#define MODELCOMPARISON_H
+
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include "modelregistry.h"
+
+// Runs several registry models, each at one or more precisions, over the
+// same local clip and reports throughput, resident memory, and recall,
+// precision and mAP@matchIou against a reference, so the cheapest variant
+// that meets a recall target can be picked. No ground truth needed: the
+// reference model in FP32 (usually the largest model) stands in.
+class ModelComparison
+{
+public:
+    struct Options {
+        QStringList models;         // Registry names, in report order
+        QList<ModelInfo::Precision> precisions = { ModelInfo::Fp32 };
+        QString calibration;        // INT8 calibration source; defaults to the clip
+        QString reference;          // Defaults to the first model
+        QString clip;               // Anything cv::VideoCapture opens
+        int frames = 200;           // Read from the start of the clip
+        double recallTarget = 0.9;
+        float matchIou = 0.5f;      // Same label and at least this overlap
+        int threads = 0;            // OpenCV threads; 0 keeps the default
+    };
+
+    // Prints the table; returns the process exit code
+    static int run(const Options &options);
+};
+
+#endif // MODELCOMPARISON_H
@@ -0,0 +1,46 @@
+#include "cpufeatures.h"
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+
+static CpuFeatures detect() {
+    CpuFeatures features;
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    // libgcc checks both CPUID and the register state the OS saves (XCR0)
+    __builtin_cpu_init();
+    features.sse41 = __builtin_cpu_supports("sse4.1");
+    features.avx2 = __builtin_cpu_supports("avx2");
+    features.avx512 = __builtin_cpu_supports("avx512f");
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    int info[4];
+    __cpuid(info, 0);
+    int maxLeaf = info[0];
+
+    __cpuid(info, 1);
+    features.sse41 = (info[2] & (1 << 19)) != 0;
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    unsigned long long xcr0 = osxsave ? _xgetbv(0) : 0;
+    bool ymmState = (xcr0 & 0x6) == 0x6;
+    bool zmmState = (xcr0 & 0xe6) == 0xe6;
+
+    if (maxLeaf >= 7) {
+        __cpuidex(info, 7, 0);
+        features.avx2 = ymmState && (info[1] & (1 << 5)) != 0;
+        features.avx512 = zmmState && (info[1] & (1 << 16)) != 0;
+    }
+#endif
+
+#if defined(__aarch64__) || defined(_M_ARM64) || defined(__ARM_NEON)
+    features.neon = true;
+#endif
+
+    return features;
+}
+
+const CpuFeatures &CpuFeatures::host() {
+    static const CpuFeatures features = detect();
+    return features;
+}
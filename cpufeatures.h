@@ -0,0 +1,24 @@
+#ifndef CPUFEATURES_H
+#define CPUFEATURES_H
+
+// Compiles one function for an instruction set extension so the rest of the
+// binary keeps the baseline target. Call it only after checking host().
+// MSVC accepts the intrinsics as is.
+#if defined(__GNUC__)
+#define CPU_TARGET(isa) __attribute__((target(isa)))
+#else
+#define CPU_TARGET(isa)
+#endif
+
+// Instruction set extensions of the host CPU that the OS also enables,
+// detected once at first use.
+struct CpuFeatures {
+    bool sse41 = false;
+    bool avx2 = false;
+    bool avx512 = false;    // AVX-512F
+    bool neon = false;      // Always present on AArch64
+
+    static const CpuFeatures &host();
+};
+
+#endif // CPUFEATURES_H
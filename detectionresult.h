@@ -0,0 +1,40 @@
+#ifndef DETECTIONRESULT_H
+#define DETECTIONRESULT_H
+
+#include <QMetaType>
+#include <string>
+#include <vector>
+#include <opencv2/core.hpp>
+#include "frametiming.h"
+
+struct Detection {
+    int classId = -1;
+    float confidence = 0.0f;
+    std::string label;
+    cv::Rect2f box;            // Normalised to the detected frame (0..1)
+    int trackId = -1;          // Stable across frames when tracking, -1 otherwise
+};
+
+// What a worker reports for one frame. Boxes are resolution independent so
+// they can be drawn on a display frame of any size.
+struct DetectionResult {
+    int streamId = -1;
+    bool detected = false;     // False when the frame was skipped or failed
+    std::vector<Detection> detections;
+    cv::Size frameSize;        // Size of the frame the worker saw
+    cv::Rect2f region{0.0f, 0.0f, 1.0f, 1.0f};   // Normalised area that was inferred
+    bool reused = false;       // Inference skipped; the last detections, or the tracker's predictions
+    bool gated = false;        // The motion gate evaluated this frame
+    double inferenceSaved = 0.0;   // Share of a full-frame inference the gate avoided
+    double processingTime = 0.0;   // Seconds, the batch's cost divided by its size
+    int batchSize = 1;             // Frames in the forward pass that produced this (1 when tiled)
+    cv::Size inputSize;            // Network input of that pass
+    int tiles = 0;                 // Tiles inferred besides the coarse pass, when tiled
+    quint64 sequence = 0;          // Per-stream frame order, from DetectionRequest
+    float fps = 0.0f;
+    FrameTiming timing;        // Source frame stamps up to InferenceEnd
+};
+
+Q_DECLARE_METATYPE(DetectionResult)
+
+#endif // DETECTIONRESULT_H
@@ -1,309 +1,392 @@
 #include "detectionworker.h"
 #include <QDebug>
-#include <QFile>
-#include <QDir>
-#include <QTemporaryFile>
 #include <QThread>
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include "latencycontroller.h"
+#include "tiling.h"
 
 DetectionWorker::DetectionWorker(QObject *parent)
-    : QObject(parent), fps(0.0f), frameCount(0), skipFrameCounter(0) {
+    : QObject(parent), fps(0.0f), frameCount(0) {
 
     fpsTimer.start();
-    QString modelPath = extractResource(":/models/yolov4-tiny.weights");
-    QString configPath = extractResource(":/models/yolov4-tiny.cfg");
-
-    if (modelPath.isEmpty() || configPath.isEmpty()) {
-        qDebug() << "Error extracting YOLO model files.";
-        return;
-    }
-
-    net = cv::dnn::readNet(modelPath.toStdString(), configPath.toStdString());
-
-    if (net.empty()) {
-        qDebug() << "Failed to load YOLOv4-Tiny!";
-        return;
-    }
-
-    // Set backend and target for acceleration
-    net.setPreferableBackend(cv::dnn::DNN_BACKEND_OPENCV);
-    net.setPreferableTarget(cv::dnn::DNN_TARGET_CPU);
-    // For GPU acceleration (if available):
-    // net.setPreferableBackend(cv::dnn::DNN_BACKEND_CUDA);
-    // net.setPreferableTarget(cv::dnn::DNN_TARGET_CUDA);
 
     // Pre-allocate blob to avoid repeated allocations
     blob = cv::Mat();
 
-    // Load class names once during initialization
-    loadClassNames();
-
     // Pre-allocate detection vectors
-    classIds.reserve(100);
-    confidences.reserve(100);
-    boxes.reserve(100);
+    candidates.reserve(100);
     indices.reserve(100);
     detectionOutputs.reserve(3);
-
-    // Cache output names
-    outputNames = getOutputsNames(net);
 }
 
-void DetectionWorker::detectObject(const QImage &qImage) {
-    if (net.empty()) {
-        qDebug() << "Error: YOLOv4-Tiny model is not loaded!";
-        return;
-    }
+DetectionWorker::DetectionWorker(const ModelInfo &model, QObject *parent)
+    : DetectionWorker(parent) {
 
-    // Skip frames for performance (process every 2nd or 3rd frame)
-    if (++skipFrameCounter % FRAME_SKIP != 0) {
-        emit detectionDone(qImage); // Return original image
+    ModelInfo info = model;
+    if (!info.isValid() && !ModelRegistry::find(ModelRegistry::DEFAULT_MODEL, info)) {
+        qDebug() << "Error: no detection model available";
         return;
     }
+    loadModel(info);
+}
 
-    frameCount++;
-    float elapsed = fpsTimer.elapsed() / 1000.0f;
-    if (elapsed >= 1.0f) {
-        fps = frameCount / elapsed;
-        frameCount = 0;
-        fpsTimer.restart();
-    }
+bool DetectionWorker::loadModel(const ModelInfo &model) {
+    loadTimings = ModelTimings();
+    QElapsedTimer timer;
+    timer.start();
 
-    QElapsedTimer frameTimer;
-    frameTimer.start();
-
-    // Convert QImage to cv::Mat more efficiently
-    cv::Mat frame = qImageToCvMat(qImage);
-
-    // Resize input if too large (major performance boost)
-    cv::Mat processFrame;
-    if (frame.cols > MAX_PROCESSING_WIDTH) {
-        double scale = static_cast<double>(MAX_PROCESSING_WIDTH) / frame.cols;
-        cv::resize(frame, processFrame, cv::Size(), scale, scale, cv::INTER_LINEAR);
-        scaleFactor = 1.0 / scale;
-    } else {
-        processFrame = frame;
-        scaleFactor = 1.0;
+    // The running network stays until its replacement works
+    std::unique_ptr<DetectorBackend> loaded = DetectorBackend::create(model);
+    if (!loaded->isLoaded()) {
+        qDebug() << "Failed to load" << model.name << "-" << (backend ? "keeping the current model" : "detection disabled");
+        return false;
+    }
+    // The latency controller's sizes get their networks now, never mid-stream
+    loaded->pinSizes(LatencyController::presetSizes(model));
+    loadTimings.readMs = timer.restart();
+
+    // Warm up with the thread count real passes will use
+    applyThreadBudget();
+    loadTimings.firstPassMs = loaded->warmUp();
+    loadTimings.warmupMs = timer.elapsed();
+    if (loadTimings.firstPassMs < 0) {
+        qDebug() << "Model" << model.name << "failed its warm-up pass -"
+                 << (backend ? "keeping the current model" : "detection disabled");
+        return false;
     }
 
-    // Prepare input blob (reuse existing blob memory)
-    cv::dnn::blobFromImage(processFrame, blob, 1.0/255.0, cv::Size(INPUT_SIZE, INPUT_SIZE),
-                           cv::Scalar(0, 0, 0), true, false, CV_32F);
-    net.setInput(blob);
-
-    // Forward pass
-    detectionOutputs.clear();
-    net.forward(detectionOutputs, outputNames);
+    backend = std::move(loaded);
+    letterbox.store(model.letterbox, std::memory_order_relaxed);
+    qDebug() << "Model" << model.name << "ready: read" << loadTimings.readMs << "ms, warm-up"
+             << loadTimings.warmupMs << "ms (first pass" << qRound(loadTimings.firstPassMs) << "ms)";
+    return true;
+}
 
-    // Clear vectors instead of recreating
-    classIds.clear();
-    confidences.clear();
-    boxes.clear();
+ModelInfo DetectionWorker::model() const {
+    return backend ? backend->info() : ModelInfo();
+}
 
-    // Process detections with early termination
-    processDetections(processFrame);
+ModelTimings DetectionWorker::timings() const {
+    return loadTimings;
+}
 
-    // Apply NMS
-    indices.clear();
-    if (!boxes.empty()) {
-        cv::dnn::NMSBoxes(boxes, confidences, CONFIDENCE_THRESHOLD, NMS_THRESHOLD, indices);
+cv::Size DetectionWorker::inputSizeFor(const cv::Size &region, const ModelInfo &model, const cv::Size &limit) {
+    const cv::Size &full = limit.area() > 0 ? limit : model.inputSize;
+    if (!model.dynamicInput || region.area() <= 0) {
+        return full;
     }
+    double scale = std::min({ 1.0, static_cast<double>(full.width) / region.width,
+                              static_cast<double>(full.height) / region.height });
+    auto align = [](double side, int limit) {
+        int aligned = (static_cast<int>(std::ceil(side)) + INPUT_GRANULARITY - 1) / INPUT_GRANULARITY * INPUT_GRANULARITY;
+        return qBound(std::min(MIN_CROP_INPUT, limit), aligned, limit);
+    };
+    return cv::Size(align(region.width * scale, full.width), align(region.height * scale, full.height));
+}
 
-    // Draw detections on original frame
-    drawDetections(frame);
+void DetectionWorker::setLetterbox(bool enabled) {
+    letterbox.store(enabled, std::memory_order_relaxed);
+}
 
-    double processingTime = frameTimer.elapsed() / 1000.0;
+void DetectionWorker::setNms(Nms::Scope scope, bool soft) {
+    nmsScope.store(scope, std::memory_order_relaxed);
+    softNms.store(soft, std::memory_order_relaxed);
+}
 
-    // Draw performance info
-    drawPerformanceInfo(frame, processingTime);
+void DetectionWorker::setThreadBudget(int threads) {
+    threadBudget.store(threads, std::memory_order_relaxed);
+}
 
-    // Convert and emit result
-    QImage processedImage = cvMatToQImage(frame);
-    emit detectionDone(processedImage);
+void DetectionWorker::detectObject(int streamId, const VideoFrame &videoFrame, const QRect &region) {
+    DetectionRequest request;
+    request.streamId = streamId;
+    request.frame = videoFrame;
+    request.region = region;
+    detectBatch({ request });
 }
 
-cv::Mat DetectionWorker::qImageToCvMat(const QImage& qImage) {
-    // More efficient conversion without format change if possible
-    if (qImage.format() == QImage::Format_RGB888) {
-        cv::Mat mat(qImage.height(), qImage.width(), CV_8UC3,
-                    const_cast<uchar*>(qImage.bits()), qImage.bytesPerLine());
-        cv::Mat result;
-        cv::cvtColor(mat, result, cv::COLOR_RGB2BGR);
-        return result;
-    } else {
-        QImage convertedImage = qImage.convertToFormat(QImage::Format_RGB888);
-        cv::Mat mat(convertedImage.height(), convertedImage.width(), CV_8UC3,
-                    const_cast<uchar*>(convertedImage.bits()), convertedImage.bytesPerLine());
-        cv::Mat result;
-        cv::cvtColor(mat, result, cv::COLOR_RGB2BGR);
-        return result;
+void DetectionWorker::detectBatch(const QVector<DetectionRequest> &requests) {
+    std::vector<Pending> pending(requests.size());
+    for (int i = 0; i < requests.size(); ++i) {
+        Pending &p = pending[i];
+        const VideoFrame &videoFrame = requests[i].frame;
+        p.request = requests[i];
+        p.result.streamId = p.request.streamId;
+        p.result.sequence = p.request.sequence;
+        p.result.frameSize = cv::Size(videoFrame.width(), videoFrame.height());
+        videoFrame.stamp(FrameTiming::InferenceStart);
+        p.result.timing = videoFrame.timing();
+        // File frames are painted before they are detected; those stamps
+        // belong to the video path, not to this result
+        p.result.timing.stamps[FrameTiming::Delivered] = 0;
+        p.result.timing.stamps[FrameTiming::Displayed] = 0;
     }
-}
 
-QImage DetectionWorker::cvMatToQImage(const cv::Mat& mat) {
-    // More efficient conversion
-    if (mat.type() == CV_8UC3) {
-        cv::Mat rgbMat;
-        cv::cvtColor(mat, rgbMat, cv::COLOR_BGR2RGB);
-        return QImage(rgbMat.data, rgbMat.cols, rgbMat.rows,
-                      rgbMat.step, QImage::Format_RGB888).copy();
+    const bool loaded = backend && backend->isLoaded();
+    if (!loaded) {
+        qDebug() << "Error: detection model is not loaded!";
     }
-    return QImage();
-}
 
-void DetectionWorker::processDetections(const cv::Mat& frame) {
-    for (const auto& output : detectionOutputs) {
-        const float* data = reinterpret_cast<const float*>(output.data);
-
-        for (int i = 0; i < output.rows; i++) {
-            const float* detection = data + i * output.cols;
-
-            // Quick confidence check before expensive operations
-            float maxScore = 0.0f;
-            int maxIndex = 0;
-            for (int j = 5; j < output.cols; j++) {
-                if (detection[j] > maxScore) {
-                    maxScore = detection[j];
-                    maxIndex = j - 5;
-                }
-            }
+    // Whole frame, or the crop the motion gate asked for at native scale.
+    // RTSP frames are the decoder's full-resolution YUV planes.
+    std::vector<Pending*> runnable;
+    for (Pending &p : pending) {
+        const VideoFrame &videoFrame = p.request.frame;
+        if (!loaded || videoFrame.isNull()) {
+            continue;
+        }
 
-            if (maxScore > CONFIDENCE_THRESHOLD) {
-                float centerX = detection[0] * frame.cols * scaleFactor;
-                float centerY = detection[1] * frame.rows * scaleFactor;
-                float width = detection[2] * frame.cols * scaleFactor;
-                float height = detection[3] * frame.rows * scaleFactor;
+        // The caller decides which frames to skip and may pick a preset
+        // input size for nets that can be reshaped
+        const ModelInfo &model = backend->info();
+        if (p.request.motionGate && !applyMotionGate(p, model)) {
+            continue;
+        }
+        p.roi = cv::Rect(0, 0, videoFrame.width(), videoFrame.height());
+        p.inputSize = p.request.inputSize.area() > 0 && model.resizable() ? p.request.inputSize : model.inputSize;
+        const QRect &region = p.request.region;
+        if (!region.isEmpty()) {
+            p.roi &= cv::Rect(region.x(), region.y(), region.width(), region.height());
+        }
 
-                int left = static_cast<int>(centerX - width / 2);
-                int top = static_cast<int>(centerY - height / 2);
+        // Areas much larger than the input are tiled at native scale;
+        // other crops run at native scale up to the input size
+        p.tiled = p.request.maxTiles > 0 && Tiling::worthTiling(p.roi.size(), p.inputSize);
+        if (!region.isEmpty() && !p.tiled) {
+            p.inputSize = inputSizeFor(p.roi.size(), model, p.inputSize);
+        }
 
-                classIds.push_back(maxIndex);
-                confidences.push_back(maxScore);
-                boxes.push_back(cv::Rect(left, top, static_cast<int>(width), static_cast<int>(height)));
-            }
+        if (p.roi.area() <= 0) {
+            continue;
+        }
+        if (p.tiled) {
+            runTiled(p);
+        } else {
+            runnable.push_back(&p);
         }
     }
-}
 
-void DetectionWorker::drawDetections(cv::Mat& frame) {
-    // Pre-calculate common values
-    static const std::vector<cv::Scalar> colors = {
-        cv::Scalar(255, 0, 0),   // Blue
-        cv::Scalar(0, 255, 0),   // Green
-        cv::Scalar(0, 0, 255),   // Red
-        cv::Scalar(255, 255, 0), // Cyan
-        cv::Scalar(255, 0, 255)  // Magenta
-    };
+    // Crops come in their own sizes; each distinct input size is one pass
+    std::vector<Pending*> batch;
+    while (!runnable.empty()) {
+        cv::Size inputSize = runnable.front()->inputSize;
+        batch.clear();
+        auto rest = std::stable_partition(runnable.begin(), runnable.end(),
+                                          [&](Pending *p) { return p->inputSize == inputSize; });
+        batch.assign(runnable.begin(), rest);
+        runnable.erase(runnable.begin(), rest);
+        runBatch(batch);
+    }
 
-    for (size_t i = 0; i < indices.size(); ++i) {
-        int idx = indices[i];
-        const cv::Rect& box = boxes[idx];
-        int classId = classIds[idx];
-        float conf = confidences[idx];
+    // Always answer every request so the caller can hand out the next frame
+    for (Pending &p : pending) {
+        emit detectionDone(p.request.streamId, p.result);
+    }
+}
 
-        if (classId >= 0 && classId < static_cast<int>(classNames.size())) {
-            cv::Scalar color = colors[classId % colors.size()];
+bool DetectionWorker::applyMotionGate(Pending &pending, const ModelInfo &model) {
+    // Runs here rather than in the manager so workers gate in parallel.
+    // Static scenes reuse the last detections, local motion is inferred on
+    // a crop; both need a full result to build on first.
+    MotionGate::Result gate = pending.request.motionGate->evaluate(pending.request.frame.analysisView());
+    pending.result.gated = true;
+    if (!pending.request.reusable) {
+        return true;
+    }
 
-            // Draw box
-            cv::rectangle(frame, box, color, 2);
+    if (gate.decision == MotionGate::Skip) {
+        pending.result.reused = true;
+        pending.result.inferenceSaved = 1.0;
+        pending.result.timing.stamps[FrameTiming::InferenceEnd] = pending.result.timing.at(FrameTiming::InferenceStart);
+        return false;
+    }
+    if (gate.decision == MotionGate::Crop && pending.request.region.isEmpty()) {
+        pending.request.region = QRect(gate.roi.x, gate.roi.y, gate.roi.width, gate.roi.height);
+        cv::Size full = pending.request.inputSize.area() > 0 ? pending.request.inputSize : model.inputSize;
+        cv::Size input = inputSizeFor(gate.roi.size(), model, full);
+        pending.result.inferenceSaved = full.area() > 0 ? 1.0 - static_cast<double>(input.area()) / full.area() : 0.0;
+    }
+    return true;
+}
 
-            // Calculate distance (simplified)
-            float pixelWidth = static_cast<float>(box.width);
-            float distanceToObject = (KNOWN_WIDTH * FOCAL_LENGTH) / pixelWidth;
+void DetectionWorker::runBatch(std::vector<Pending*> &batch) {
+    QElapsedTimer batchTimer;
+    batchTimer.start();
 
-            // Create label
-            std::string label = classNames[classId] + ": " +
-                                std::to_string(static_cast<int>(conf * 100)) + "% " +
-                                "dist: " + std::to_string(distanceToObject).substr(0, 4) + "m";
+    inputs.assign(batch.size(), Input());
+    for (size_t b = 0; b < batch.size(); ++b) {
+        inputs[b].owner = batch[b];
+        inputs[b].image = static_cast<int>(b);
+        inputs[b].roi = batch[b]->roi;
+    }
+    candidates.clear();
+    if (!infer(batch.front()->inputSize)) {
+        return;
+    }
+    qint64 inferenceEnd = VideoFrame::nowNs();
 
-            // Draw label with background
-            int baseLine;
-            cv::Size labelSize = cv::getTextSize(label, cv::FONT_HERSHEY_SIMPLEX, 0.5, 1, &baseLine);
-            int labelTop = std::max(box.y, labelSize.height);
+    for (Pending *p : batch) {
+        p->result.batchSize = static_cast<int>(batch.size());
+    }
+    finish(batch, inferenceEnd, batchTimer.elapsed() / 1000.0);
+}
 
-            cv::rectangle(frame,
-                          cv::Point(box.x, labelTop - labelSize.height - 10),
-                          cv::Point(box.x + labelSize.width, labelTop + baseLine - 10),
-                          color, cv::FILLED);
+void DetectionWorker::runTiled(Pending &pending) {
+    QElapsedTimer batchTimer;
+    batchTimer.start();
 
-            cv::putText(frame, label,
-                        cv::Point(box.x, labelTop - 10),
-                        cv::FONT_HERSHEY_SIMPLEX, 0.5, cv::Scalar(255, 255, 255), 1);
+    // Coarse pass over the whole area; its weak candidates only pick tiles
+    inputs.assign(1, Input());
+    inputs[0].owner = &pending;
+    inputs[0].roi = pending.roi;
+    candidates.clear();
+    if (!infer(pending.inputSize, Tiling::HINT_THRESHOLD_SCALE)) {
+        return;
+    }
+
+    // The chosen tiles at native scale, as one batch
+    std::vector<cv::Rect> tiles = Tiling::grid(pending.roi, pending.inputSize);
+    std::vector<int> chosen = Tiling::select(tiles, candidates, 0, candidates.size(),
+                                             pending.request.maxTiles, pending.request.tileRound);
+    if (!chosen.empty()) {
+        inputs.assign(chosen.size(), Input());
+        for (size_t i = 0; i < chosen.size(); ++i) {
+            inputs[i].owner = &pending;
+            inputs[i].roi = tiles[chosen[i]];
+            inputs[i].tile = true;
+        }
+        if (!infer(pending.inputSize)) {
+            return;
         }
     }
+    qint64 inferenceEnd = VideoFrame::nowNs();
+
+    // Seams are merged by the frame's NMS, like any other overlap. Its
+    // passes held only this frame.
+    pending.result.tiles = static_cast<int>(chosen.size());
+    pending.result.batchSize = 1;
+    std::vector<Pending*> owners = { &pending };
+    finish(owners, inferenceEnd, batchTimer.elapsed() / 1000.0);
 }
 
-void DetectionWorker::drawPerformanceInfo(cv::Mat& frame, double processingTime) {
-    // Pre-format strings to avoid repeated string operations
-    static std::string fpsText, timeText, dimensionsText;
-
-    fpsText = "FPS: " + std::to_string(static_cast<int>(fps));
-    timeText = "Time: " + std::to_string(processingTime).substr(0, 5) + "s";
-    dimensionsText = "Size: " + std::to_string(frame.cols) + "x" + std::to_string(frame.rows);
+bool DetectionWorker::infer(const cv::Size &inputSize, float thresholdScale) {
+    const int batchSize = static_cast<int>(inputs.size());
+
+    // Colour conversion, resize and normalisation in one pass per input,
+    // straight into its slice of the reused blob
+    const int dims[] = { batchSize, 3, inputSize.height, inputSize.width };
+    blob.create(4, dims, CV_32F);
+    bool letterboxed = letterbox.load(std::memory_order_relaxed);
+    for (int b = 0; b < batchSize; ++b) {
+        Input &input = inputs[b];
+        if (!Preprocessor::toBlobAt(input.owner->request.frame, input.roi, letterboxed, blob, b, &input.mapping)) {
+            return false;
+        }
+    }
 
-    // Draw background
-    cv::rectangle(frame, cv::Point(10, 10), cv::Point(160, 80), cv::Scalar(0, 0, 0), cv::FILLED);
+    applyThreadBudget();
 
-    // Draw text
-    cv::putText(frame, fpsText, cv::Point(15, 30), cv::FONT_HERSHEY_SIMPLEX, 0.55, cv::Scalar(0, 255, 255), 2);
-    cv::putText(frame, timeText, cv::Point(15, 50), cv::FONT_HERSHEY_SIMPLEX, 0.55, cv::Scalar(0, 255, 255), 2);
-    cv::putText(frame, dimensionsText, cv::Point(15, 70), cv::FONT_HERSHEY_SIMPLEX, 0.55, cv::Scalar(0, 255, 255), 2);
-}
+    // Forward pass; the backend keeps the model's size, the latency presets
+    // and crops on separate networks, so alternating between them does not
+    // reshape any back and forth
+    if (!backend->forward(blob, detectionOutputs)) {
+        return false;
+    }
 
-void DetectionWorker::loadClassNames() {
-    QString namesPath = extractResource(":/models/coco.names");
-    QFile file(namesPath);
-    if (file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        QTextStream in(&file);
-        classNames.reserve(80); // COCO has 80 classes
-        while (!in.atEnd()) {
-            QString line = in.readLine().trimmed();
-            if (!line.isEmpty()) {
-                classNames.push_back(line.toStdString());
+    // Reject on objectness, then pick the best class of the survivors.
+    // Boxes move from their input's area to frame pixels.
+    for (int b = 0; b < batchSize; ++b) {
+        const Input &input = inputs[b];
+        const int first = candidates.size();
+        backend->decode(detectionOutputs, b, batchSize, inputSize, input.mapping, candidates, thresholdScale);
+        int kept = first;
+        for (int i = first; i < candidates.size(); ++i) {
+            float left = candidates.left[i] + input.roi.x;
+            float top = candidates.top[i] + input.roi.y;
+            if (input.tile && Tiling::cutBySeam(input.roi, input.owner->roi, left, top,
+                                                candidates.width[i], candidates.height[i])) {
+                continue;
             }
+            candidates.left[kept] = left;
+            candidates.top[kept] = top;
+            candidates.width[kept] = candidates.width[i];
+            candidates.height[kept] = candidates.height[i];
+            candidates.score[kept] = candidates.score[i];
+            candidates.classId[kept] = candidates.classId[i];
+            candidates.image[kept] = input.image;
+            kept++;
         }
-        file.close();
-    } else {
-        qDebug() << "Failed to load class names from" << namesPath;
+        candidates.resize(kept);
     }
+    return true;
 }
 
-QString DetectionWorker::extractResource(const QString &resourcePath) {
-    QFile file(resourcePath);
-    if (!file.exists()) {
-        qDebug() << "Resource does not exist: " << resourcePath;
-        return QString();
+void DetectionWorker::finish(const std::vector<Pending*> &owners, qint64 inferenceEnd, double seconds) {
+    const int count = static_cast<int>(owners.size());
+    frameCount += count;
+    float elapsed = fpsTimer.elapsed() / 1000.0f;
+    if (elapsed >= 1.0f) {
+        fps = frameCount / elapsed;
+        frameCount = 0;
+        fpsTimer.restart();
     }
 
-    if (!file.open(QIODevice::ReadOnly)) {
-        qDebug() << "Failed to open resource file: " << resourcePath;
-        return QString();
+    // One NMS pass for all owners; images never suppress each other
+    const ModelInfo &model = backend->info();
+    Nms::Config nmsConfig;
+    nmsConfig.scope = static_cast<Nms::Scope>(nmsScope.load(std::memory_order_relaxed));
+    nmsConfig.soft = softNms.load(std::memory_order_relaxed);
+    nmsConfig.iouThreshold = model.nmsThreshold;
+    nmsConfig.scoreThreshold = model.confidenceThreshold;
+    nms.run(candidates, nmsConfig, indices);
+
+    for (Pending *p : owners) {
+        DetectionResult &result = p->result;
+        const float frameWidth = static_cast<float>(result.frameSize.width);
+        const float frameHeight = static_cast<float>(result.frameSize.height);
+        result.region = cv::Rect2f(p->roi.x / frameWidth, p->roi.y / frameHeight,
+                                   p->roi.width / frameWidth, p->roi.height / frameHeight);
+        result.detected = true;
+        result.inputSize = p->inputSize;
+        result.timing.stamps[FrameTiming::InferenceEnd] = inferenceEnd;
+        p->request.frame.stamp(FrameTiming::InferenceEnd, inferenceEnd);
+        result.fps = fps;
     }
 
-    QString tempPath = QDir::tempPath() + "/" + QFileInfo(resourcePath).fileName();
-    QFile extractedFile(tempPath);
-
-    if (extractedFile.exists()) {
-        return tempPath;
+    // Report boxes normalised to the frame; the display draws them at its own size
+    const std::vector<std::string> &classNames = backend->classNames();
+    for (int idx : indices) {
+        DetectionResult &result = owners[candidates.image[idx]]->result;
+        float invWidth = 1.0f / result.frameSize.width;
+        float invHeight = 1.0f / result.frameSize.height;
+
+        Detection detection;
+        detection.classId = candidates.classId[idx];
+        detection.confidence = candidates.score[idx];
+        if (detection.classId >= 0 && detection.classId < static_cast<int>(classNames.size())) {
+            detection.label = classNames[detection.classId];
+        }
+        detection.box = cv::Rect2f(candidates.left[idx] * invWidth, candidates.top[idx] * invHeight,
+                                   candidates.width[idx] * invWidth, candidates.height[idx] * invHeight);
+        result.detections.push_back(detection);
     }
 
-    if (!extractedFile.open(QIODevice::WriteOnly)) {
-        qDebug() << "Failed to create temp file: " << tempPath;
-        return QString();
+    // The pass is shared, so is its cost
+    double amortized = seconds / count;
+    for (Pending *p : owners) {
+        p->result.processingTime = amortized;
     }
-
-    extractedFile.write(file.readAll());
-    extractedFile.close();
-    return tempPath;
 }
 
-std::vector<std::string> DetectionWorker::getOutputsNames(const cv::dnn::Net &net) {
-    std::vector<int> outLayers = net.getUnconnectedOutLayers();
-    std::vector<cv::String> layerNames = net.getLayerNames();
-    std::vector<std::string> names;
-    names.reserve(outLayers.size());
-
-    for (size_t i = 0; i < outLayers.size(); ++i) {
-        names.push_back(layerNames[outLayers[i] - 1]);
+void DetectionWorker::applyThreadBudget() {
+    // OpenCV's thread count belongs to the calling thread with OpenMP and is
+    // shared by the process otherwise; every worker asks for the same
+    // budget so the pool's networks split the cores instead of fighting
+    int threads = threadBudget.load(std::memory_order_relaxed);
+    if (threads > 0 && threads != appliedThreads) {
+        cv::setNumThreads(threads);
+        appliedThreads = threads;
     }
-    return names;
 }
@@ -4,61 +4,151 @@
 #include <QObject>
 #include <QImage>
 #include <QElapsedTimer>
+#include <QRect>
+#include <QSharedPointer>
+#include <QVector>
 #include <opencv2/opencv.hpp>
-#include <opencv2/dnn.hpp>
+#include <atomic>
+#include <memory>
+#include "videoframe.h"
+#include "detectionresult.h"
+#include "preprocessor.h"
+#include "yolodecoder.h"
+#include "nms.h"
+#include "detectorbackend.h"
+#include "motiongate.h"
+
+// One frame to detect; an empty region infers the whole frame
+struct DetectionRequest {
+    int streamId = -1;
+    VideoFrame frame;
+    QRect region;
+    cv::Size inputSize;     // Network input; empty uses the model's
+    int maxTiles = 0;       // Tile large frames, up to this many tiles besides a coarse pass
+    quint64 tileRound = 0;  // Per-stream count of tiled requests; rotates the unhinted tiles
+    quint64 sequence = 0;   // Echoed in the result for reordering
+    QSharedPointer<MotionGate> motionGate;  // Evaluated by the worker first; null when gating is off
+    bool reusable = false;  // The stream has detections a static frame may reuse
+};
+
+Q_DECLARE_METATYPE(DetectionRequest)
+
+// What the last loadModel cost, in milliseconds; -1 when it failed
+struct ModelTimings {
+    qint64 readMs = -1;         // Parsing the model bytes and configuring the net
+    qint64 warmupMs = -1;       // All warm-up passes
+    double firstPassMs = -1.0;  // The first of them, which a real frame would have paid
+};
 
 class DetectionWorker : public QObject
 {
     Q_OBJECT
 
 public:
+    // Without a model; call loadModel on the worker's thread
     explicit DetectionWorker(QObject *parent = nullptr);
+    // Loads model, or the registry's default one, on the calling thread
+    explicit DetectionWorker(const ModelInfo &model, QObject *parent = nullptr);
 
     // Performance tuning constants
-    static constexpr int FRAME_SKIP = 2;              // Process every 2nd frame
-    static constexpr int MAX_PROCESSING_WIDTH = 640;   // Max width for processing
-    static constexpr int INPUT_SIZE = 416;             // YOLO input size
-    static constexpr float CONFIDENCE_THRESHOLD = 0.5f;
-    static constexpr float NMS_THRESHOLD = 0.4f;
     static constexpr float KNOWN_WIDTH = 0.60f;        // Average width of a person in meters
     static constexpr float FOCAL_LENGTH = 615.0f;      // Focal length (needs calibration)
+    static constexpr int INPUT_GRANULARITY = 32;       // Network stride; crop inputs are multiples of it
+    static constexpr int MIN_CROP_INPUT = 96;
+    static constexpr Nms::Scope DEFAULT_NMS_SCOPE = Nms::PerClass;
+
+    // Network input used for a region: native scale up to the model's
+    // input size (or limit), or exactly that size for models with a fixed input
+    static cv::Size inputSizeFor(const cv::Size &region, const ModelInfo &model, const cv::Size &limit = cv::Size());
+
+    // Keep the aspect ratio with grey borders instead of stretching. Any
+    // thread. Defaults to how the model was trained.
+    void setLetterbox(bool enabled);
+
+    // Suppress overlaps per class or across classes, optionally with
+    // Soft-NMS. Any thread; applied from the next batch.
+    void setNms(Nms::Scope scope, bool soft);
+
+    // OpenCV threads for this worker's forward passes. Any thread; applied
+    // before the next pass.
+    void setThreadBudget(int threads);
+
+    // The loaded model as it runs, e.g. with the precision the backend
+    // managed. Call on the worker's thread.
+    ModelInfo model() const;
+    ModelTimings timings() const;
 
 public slots:
-    void detectObject(const QImage &qImage);
+    // Loads and warms up a network, then replaces the current one with it;
+    // on failure the current one keeps running (none on the first load).
+    // Call on the worker's thread.
+    bool loadModel(const ModelInfo &model);
+
+    // An empty region infers the whole frame; otherwise only that crop, in
+    // frame pixels. Boxes are reported relative to the whole frame either way.
+    void detectObject(int streamId, const VideoFrame &videoFrame, const QRect &region = QRect());
+
+    // Frames sharing an input size run as one NxCxHxW forward pass; every
+    // request gets its own detectionDone, in order
+    void detectBatch(const QVector<DetectionRequest> &requests);
 
 signals:
-    void detectionDone(const QImage &result);
+    void detectionDone(int streamId, const DetectionResult &result);
 
 private:
     // Core detection components
-    cv::dnn::Net net;
-    std::vector<std::string> classNames;
-    std::vector<std::string> outputNames;
+    std::unique_ptr<DetectorBackend> backend;
 
     // Pre-allocated memory for performance
     cv::Mat blob;
     std::vector<cv::Mat> detectionOutputs;
-    std::vector<int> classIds;
-    std::vector<float> confidences;
-    std::vector<cv::Rect> boxes;
+    DetectionCandidates candidates;
+    Nms nms;
     std::vector<int> indices;
+    std::atomic<bool> letterbox{false};
+    std::atomic<int> nmsScope{DEFAULT_NMS_SCOPE};
+    std::atomic<bool> softNms{false};
+    std::atomic<int> threadBudget{0};   // 0 keeps OpenCV's default
+    int appliedThreads = 0;
+    ModelTimings loadTimings;
 
     // Performance tracking
     QElapsedTimer fpsTimer;
     float fps;
     int frameCount;
-    int skipFrameCounter;
-    double scaleFactor;
 
     // Helper methods
-    cv::Mat qImageToCvMat(const QImage& qImage);
-    QImage cvMatToQImage(const cv::Mat& mat);
-    void processDetections(const cv::Mat& frame);
-    void drawDetections(cv::Mat& frame);
-    void drawPerformanceInfo(cv::Mat& frame, double processingTime);
-    void loadClassNames();
-    QString extractResource(const QString &resourcePath);
-    std::vector<std::string> getOutputsNames(const cv::dnn::Net &net);
+    struct Pending {
+        DetectionRequest request;
+        DetectionResult result;
+        cv::Rect roi;                   // Inferred area, frame pixels
+        cv::Size inputSize;
+        bool tiled = false;
+    };
+
+    // One network input: a pending area, or one tile of it
+    struct Input {
+        Pending *owner = nullptr;
+        int image = 0;                  // Owner's index in the candidates
+        cv::Rect roi;
+        bool tile = false;              // Drop boxes cut by the tile's inner seams
+        Preprocessor::Mapping mapping;
+    };
+    std::vector<Input> inputs;
+
+    // False when the gate found nothing changed and the frame reuses the
+    // last detections; a crop it asks for becomes the request's region
+    bool applyMotionGate(Pending &pending, const ModelInfo &model);
+    void runBatch(std::vector<Pending*> &batch);   // Non-empty, one input size
+    void runTiled(Pending &pending);
+
+    // Preprocesses inputs into one blob, runs it and appends their
+    // candidates in frame pixels. False when the pass failed.
+    bool infer(const cv::Size &inputSize, float thresholdScale = 1.0f);
+    void applyThreadBudget();
+
+    // NMS over the candidates and the owners' results
+    void finish(const std::vector<Pending*> &owners, qint64 inferenceEnd, double seconds);
 };
 
 #endif // DETECTIONWORKER_H
@@ -0,0 +1,384 @@
+#include "detectorbackend.h"
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QMutex>
+#include <QTextStream>
+#include <algorithm>
+#include <opencv2/core/version.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/videoio.hpp>
+#include "preprocessor.h"
+
+#define DNN_VERSION_AT_LEAST(major, minor) \
+    (CV_VERSION_MAJOR > (major) || (CV_VERSION_MAJOR == (major) && CV_VERSION_MINOR >= (minor)))
+
+namespace {
+
+class DarknetBackend : public DetectorBackend
+{
+public:
+    explicit DarknetBackend(const ModelInfo &info) : DetectorBackend(info) {}
+
+protected:
+    cv::dnn::Net readNet() override {
+        std::shared_ptr<const ModelFile> weights = openFile(m_info.modelPath);
+        std::shared_ptr<const ModelFile> config = openFile(m_info.configPath);
+        if (!weights || !config) {
+            return cv::dnn::Net();
+        }
+        return cv::dnn::readNetFromDarknet(config->data(), config->size(), weights->data(), weights->size());
+    }
+};
+
+class OnnxBackend : public DetectorBackend
+{
+public:
+    explicit OnnxBackend(const ModelInfo &info) : DetectorBackend(info) {}
+
+protected:
+    cv::dnn::Net readNet() override {
+        std::shared_ptr<const ModelFile> model = openFile(m_info.modelPath);
+        if (!model) {
+            return cv::dnn::Net();
+        }
+        return cv::dnn::readNetFromONNX(model->data(), model->size());
+    }
+};
+
+} // namespace
+
+DetectorBackend::ModelFile::ModelFile(const QString &path)
+    : m_file(path) {
+
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+    qint64 size = m_file.size();
+    if (size <= 0) {
+        return;
+    }
+
+    // Resources stored uncompressed map to their place in the binary
+    if (uchar *mapped = m_file.map(0, size)) {
+        m_data = reinterpret_cast<const char *>(mapped);
+    } else {
+        m_copy = m_file.readAll();
+        m_data = m_copy.isEmpty() ? nullptr : m_copy.constData();
+        size = m_copy.size();
+    }
+    m_size = static_cast<size_t>(size);
+}
+
+std::shared_ptr<const DetectorBackend::ModelFile> DetectorBackend::openFile(const QString &path) {
+    static QMutex mutex;
+    static QHash<QString, std::weak_ptr<const ModelFile>> files;
+
+    QMutexLocker locker(&mutex);
+    std::shared_ptr<const ModelFile> file = files.value(path).lock();
+    if (file) {
+        return file;
+    }
+
+    auto opened = std::make_shared<ModelFile>(path);
+    if (!opened->isOpen()) {
+        qDebug() << "Failed to read model file:" << path;
+        return nullptr;
+    }
+    files.insert(path, opened);
+    return opened;
+}
+
+DetectorBackend::DetectorBackend(const ModelInfo &info)
+    : m_info(info) {
+}
+
+std::unique_ptr<DetectorBackend> DetectorBackend::create(const ModelInfo &info) {
+    std::unique_ptr<DetectorBackend> backend;
+    switch (info.format) {
+    case ModelInfo::Onnx:
+        backend.reset(new OnnxBackend(info));
+        break;
+    case ModelInfo::Darknet:
+    default:
+        backend.reset(new DarknetBackend(info));
+        break;
+    }
+    backend->load();
+    return backend;
+}
+
+bool DetectorBackend::load() {
+    m_net = createNet();
+    if (m_net.empty()) {
+        qDebug() << "Failed to load model" << m_info.name;
+        return false;
+    }
+
+    // Darknet nets have one region layer per head; ONNX exports usually a
+    // single output
+    std::vector<int> outLayers = m_net.getUnconnectedOutLayers();
+    std::vector<cv::String> layerNames = m_net.getLayerNames();
+    m_outputNames.clear();
+    for (int layer : outLayers) {
+        m_outputNames.push_back(layerNames[layer - 1]);
+    }
+
+    loadClassNames();
+    qDebug() << "Loaded model" << m_info.name << m_info.inputSize.width << "x" << m_info.inputSize.height
+             << ModelInfo::precisionName(m_info.precision) << m_classNames.size() << "classes";
+    return true;
+}
+
+cv::dnn::Net DetectorBackend::createNet() {
+    cv::dnn::Net net;
+    try {
+        net = readNet();
+    } catch (const cv::Exception &e) {
+        qCritical() << "Failed to read model" << m_info.name << ":" << e.what();
+        return cv::dnn::Net();
+    }
+    if (!net.empty()) {
+        net.setPreferableBackend(cv::dnn::DNN_BACKEND_OPENCV);
+        net.setPreferableTarget(cv::dnn::DNN_TARGET_CPU);
+        applyPrecision(net);
+    }
+    return net;
+}
+
+bool DetectorBackend::cpuHasFp16() {
+#if DNN_VERSION_AT_LEAST(4, 9) && defined(CV_CPU_NEON_FP16)
+    const std::vector<cv::dnn::Target> targets = cv::dnn::getAvailableTargets(cv::dnn::DNN_BACKEND_OPENCV);
+    return std::find(targets.begin(), targets.end(), cv::dnn::DNN_TARGET_CPU_FP16) != targets.end()
+           && cv::checkHardwareSupport(CV_CPU_NEON_FP16);
+#else
+    return false;
+#endif
+}
+
+void DetectorBackend::applyPrecision(cv::dnn::Net &net) {
+    switch (m_info.precision) {
+    case ModelInfo::Fp16:
+#if DNN_VERSION_AT_LEAST(4, 9)
+        // Without native FP16 arithmetic the target only converts, slower
+        // than FP32; report what actually runs
+        if (cpuHasFp16()) {
+            net.setPreferableTarget(cv::dnn::DNN_TARGET_CPU_FP16);
+        } else {
+            qDebug() << "No native FP16 on this CPU, running" << m_info.name << "in FP32";
+            m_info.precision = ModelInfo::Fp32;
+        }
+#else
+        qDebug() << "FP16 CPU target needs OpenCV 4.9, running" << m_info.name << "in FP32";
+        m_info.precision = ModelInfo::Fp32;
+#endif
+        break;
+    case ModelInfo::Int8:
+        // A quantized file already holds INT8 layers; otherwise calibrate
+        if (!m_info.quantized && !quantize(net)) {
+            qDebug() << "Running" << m_info.name << "in FP32";
+            m_info.precision = ModelInfo::Fp32;
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+// Post-training quantization: activation ranges come from a forward pass
+// over the calibration inputs. Inputs and outputs stay FP32 so the
+// preprocessor and decoders need no changes.
+bool DetectorBackend::quantize(cv::dnn::Net &net) {
+#if DNN_VERSION_AT_LEAST(4, 6)
+    std::vector<cv::Mat> blobs = calibrationBlobs();
+    if (blobs.empty()) {
+        qDebug() << "No calibration inputs for" << m_info.name << "at" << m_info.calibrationPath;
+        return false;
+    }
+    try {
+        cv::dnn::Net quantized = net.quantize(blobs, CV_32F, CV_32F);
+        quantized.setPreferableBackend(cv::dnn::DNN_BACKEND_OPENCV);
+        quantized.setPreferableTarget(cv::dnn::DNN_TARGET_CPU);
+        net = quantized;
+    } catch (const cv::Exception &e) {
+        qCritical() << "Failed to quantize" << m_info.name << ":" << e.what();
+        return false;
+    }
+    qDebug() << "Quantized" << m_info.name << "to INT8 on" << blobs.size() << "calibration inputs";
+    return true;
+#else
+    qDebug() << "INT8 quantization needs OpenCV 4.6";
+    return false;
+#endif
+}
+
+// Up to CALIBRATION_FRAMES inputs, preprocessed exactly as at inference.
+// calibrationPath is a directory of images or anything VideoCapture opens;
+// clip frames are spread over its length rather than taken from the start.
+std::vector<cv::Mat> DetectorBackend::calibrationBlobs() const {
+    std::vector<cv::Mat> images;
+    QFileInfo source(m_info.calibrationPath);
+    if (m_info.calibrationPath.isEmpty() || !source.exists()) {
+        return {};
+    }
+
+    if (source.isDir()) {
+        QDir dir(source.filePath());
+        const QStringList files = dir.entryList({ "*.jpg", "*.jpeg", "*.png", "*.bmp" }, QDir::Files, QDir::Name);
+        for (const QString &file : files) {
+            cv::Mat image = cv::imread(dir.filePath(file).toStdString());
+            if (!image.empty()) {
+                images.push_back(image);
+            }
+            if (static_cast<int>(images.size()) == ModelInfo::CALIBRATION_FRAMES) {
+                break;
+            }
+        }
+    } else {
+        cv::VideoCapture capture(source.filePath().toStdString());
+        int frameCount = static_cast<int>(capture.get(cv::CAP_PROP_FRAME_COUNT));
+        int step = std::max(1, frameCount / ModelInfo::CALIBRATION_FRAMES);
+        cv::Mat frame;
+        for (int i = 0; static_cast<int>(images.size()) < ModelInfo::CALIBRATION_FRAMES && capture.read(frame); ++i) {
+            if (i % step == 0) {
+                images.push_back(frame.clone());
+            }
+        }
+    }
+
+    std::vector<cv::Mat> blobs;
+    for (const cv::Mat &image : images) {
+        cv::Mat blob;
+        if (Preprocessor::toBlob(VideoFrame::fromMat(image), cv::Rect(0, 0, image.cols, image.rows),
+                                 m_info.inputSize, m_info.letterbox, blob)) {
+            blobs.push_back(blob);
+        }
+    }
+    return blobs;
+}
+
+void DetectorBackend::pinSizes(const std::vector<cv::Size> &sizes) {
+    if (m_net.empty()) {
+        return;
+    }
+
+    // The main network keeps the model's own size
+    for (const cv::Size &size : sizes) {
+        const std::pair<int, int> key(size.width, size.height);
+        if (size == m_info.inputSize || m_pinned.count(key)) {
+            continue;
+        }
+        if (static_cast<int>(m_pinned.size()) == MAX_PINNED_SIZES) {
+            break;
+        }
+        cv::dnn::Net shaped = createCopy();
+        if (!shaped.empty()) {
+            m_pinned.emplace(key, shaped);
+            qDebug() << "Pinned a" << size.width << "x" << size.height << "network for" << m_info.name;
+        }
+    }
+
+    // Crops come in any aligned size; they reshape a scratch network
+    if (m_info.dynamicInput && m_scratch.empty()) {
+        m_scratch = createCopy();
+    }
+}
+
+cv::dnn::Net DetectorBackend::createCopy() {
+    // A copy that fell back to another precision would run differently
+    // from the main network, and relabel it
+    const ModelInfo::Precision precision = m_info.precision;
+    cv::dnn::Net net = createNet();
+    if (m_info.precision != precision) {
+        qDebug() << "Could not copy" << m_info.name << "at" << ModelInfo::precisionName(precision);
+        m_info.precision = precision;
+        return cv::dnn::Net();
+    }
+    return net;
+}
+
+bool DetectorBackend::forward(const cv::Mat &blob, std::vector<cv::Mat> &outputs) {
+    outputs.clear();
+    if (m_net.empty()) {
+        return false;
+    }
+
+    // The main network stays at the model's own size, pinned sizes have
+    // theirs, anything else reshapes the scratch network
+    cv::dnn::Net *net = &m_net;
+    const std::pair<int, int> size(blob.size[3], blob.size[2]);
+    if (cv::Size(size.first, size.second) != m_info.inputSize) {
+        auto it = m_pinned.find(size);
+        if (it != m_pinned.end()) {
+            net = &it->second;
+        } else if (!m_scratch.empty()) {
+            net = &m_scratch;
+        }
+    }
+
+    try {
+        net->setInput(blob);
+        net->forward(outputs, m_outputNames);
+    } catch (const cv::Exception &e) {
+        qCritical() << "Forward pass failed:" << e.what();
+        return false;
+    }
+    return true;
+}
+
+double DetectorBackend::warmUp() {
+    if (m_net.empty()) {
+        return -1.0;
+    }
+
+    const int sizes[] = { 1, 3, m_info.inputSize.height, m_info.inputSize.width };
+    cv::Mat blob(4, sizes, CV_32F, cv::Scalar(0));
+    std::vector<cv::Mat> outputs;
+    double firstMs = -1.0;
+    for (int i = 0; i < WARMUP_PASSES; ++i) {
+        int64 start = cv::getTickCount();
+        if (!forward(blob, outputs)) {
+            return -1.0;
+        }
+        if (i == 0) {
+            firstMs = (cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency();
+        }
+    }
+
+    // Pinned networks allocate on their first pass too
+    for (const auto &pinned : m_pinned) {
+        const int shape[] = { 1, 3, pinned.first.second, pinned.first.first };
+        if (!forward(cv::Mat(4, shape, CV_32F, cv::Scalar(0)), outputs)) {
+            return -1.0;
+        }
+    }
+    return firstMs;
+}
+
+void DetectorBackend::decode(const std::vector<cv::Mat> &outputs, int batchIndex, int batchSize,
+                             const cv::Size &inputSize, const Preprocessor::Mapping &mapping,
+                             DetectionCandidates &out, float thresholdScale) const {
+    for (const cv::Mat &output : outputs) {
+        YoloDecoder::decode(m_info.layout, output, batchIndex, batchSize, inputSize, mapping,
+                            m_info.confidenceThreshold * thresholdScale, out);
+    }
+}
+
+void DetectorBackend::loadClassNames() {
+    m_classNames.clear();
+    QFile file(m_info.classesPath);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        qDebug() << "Failed to load class names from" << m_info.classesPath;
+        return;
+    }
+
+    QTextStream in(&file);
+    while (!in.atEnd()) {
+        QString line = in.readLine().trimmed();
+        if (!line.isEmpty()) {
+            m_classNames.push_back(line.toStdString());
+        }
+    }
+}
@@ -0,0 +1,104 @@
+#ifndef DETECTORBACKEND_H
+#define DETECTORBACKEND_H
+
+#include <QByteArray>
+#include <QFile>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <opencv2/dnn.hpp>
+#include "modelregistry.h"
+#include "yolodecoder.h"
+
+// A loaded detector: the network, its class names and the decoder for its
+// output layout. create() picks the implementation for the model format;
+// everything after loading is shared.
+class DetectorBackend
+{
+public:
+    virtual ~DetectorBackend() = default;
+
+    static constexpr int MAX_PINNED_SIZES = 3;   // Each holds its own copy of the weights
+    static constexpr int WARMUP_PASSES = 2;      // The first pays lazy allocation and layer setup
+
+    static std::unique_ptr<DetectorBackend> create(const ModelInfo &info);
+
+    // info().precision is what the net actually runs at, which can be
+    // lower than requested when this OpenCV lacks the target
+    const ModelInfo &info() const { return m_info; }
+    const std::vector<std::string> &classNames() const { return m_classNames; }
+    bool isLoaded() const { return !m_net.empty(); }
+
+    // Gives up to MAX_PINNED_SIZES input sizes a network of their own, so
+    // alternating between them reshapes each once, and models with dynamic
+    // input a scratch network for crops. Built here, at load, with the
+    // precision the main network got; a copy that cannot match it is left out.
+    void pinSizes(const std::vector<cv::Size> &sizes);
+
+    // Runs blob (Nx3xHxW) through the network for its size: the main one at
+    // the model's size, a pinned one, or the scratch one, so a crop never
+    // reshapes the others. False when the pass failed.
+    bool forward(const cv::Mat &blob, std::vector<cv::Mat> &outputs);
+
+    // WARMUP_PASSES passes on a blank input of the model's size, and one per
+    // pinned size, so the first real frames run at steady-state speed.
+    // Returns the first pass's milliseconds, -1 when not loaded.
+    double warmUp();
+
+    // Appends image batchIndex's candidates above the model's threshold,
+    // times thresholdScale
+    void decode(const std::vector<cv::Mat> &outputs, int batchIndex, int batchSize, const cv::Size &inputSize,
+                const Preprocessor::Mapping &mapping, DetectionCandidates &out, float thresholdScale = 1.0f) const;
+
+protected:
+    explicit DetectorBackend(const ModelInfo &info);
+
+    // A model file's bytes without a copy: Qt resources are read in place,
+    // files on disk are mapped. Only compressed resources are read into memory.
+    class ModelFile
+    {
+    public:
+        explicit ModelFile(const QString &path);
+        ModelFile(const ModelFile &) = delete;
+        ModelFile &operator=(const ModelFile &) = delete;
+
+        bool isOpen() const { return m_data != nullptr; }
+        const char *data() const { return m_data; }
+        size_t size() const { return m_size; }
+
+    private:
+        QFile m_file;
+        QByteArray m_copy;
+        const char *m_data = nullptr;
+        size_t m_size = 0;
+    };
+
+    // Reads the network from the model files' bytes
+    virtual cv::dnn::Net readNet() = 0;
+
+    // Backends reading the same file at once share one ModelFile, so a pool
+    // of workers loading in parallel maps the weights once. The net copies
+    // what it needs; drop the file after parsing. Null when unreadable.
+    static std::shared_ptr<const ModelFile> openFile(const QString &path);
+
+    ModelInfo m_info;
+
+private:
+    bool load();
+    cv::dnn::Net createNet();
+    cv::dnn::Net createCopy();   // Empty unless it got the main network's precision
+    static bool cpuHasFp16();   // Available as a target and native in hardware
+    void applyPrecision(cv::dnn::Net &net);
+    bool quantize(cv::dnn::Net &net);
+    std::vector<cv::Mat> calibrationBlobs() const;
+    void loadClassNames();
+
+    cv::dnn::Net m_net;
+    std::map<std::pair<int, int>, cv::dnn::Net> m_pinned;   // By input width and height
+    cv::dnn::Net m_scratch;                                  // Other sizes; empty for fixed-input models
+    std::vector<std::string> m_outputNames;
+    std::vector<std::string> m_classNames;
+};
+
+#endif // DETECTORBACKEND_H
@@ -0,0 +1,275 @@
+#include "eventrecorder.h"
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QRegularExpression>
+#include <QThreadPool>
+#include <gst/app/gstappsrc.h>
+
+EventRecorder::EventRecorder(const QString &outputDir, const QString &fileStem, const QString &container)
+    : m_outputDir(outputDir)
+    , m_fileStem(fileStem)
+    , m_container(container) {
+
+    // Stems come from URLs; keep them valid file names everywhere
+    m_fileStem.replace(QRegularExpression("[^A-Za-z0-9._-]"), "_");
+    QDir().mkpath(m_outputDir);
+    m_clock.start();
+    m_pool.setMaxThreadCount(1);
+}
+
+EventRecorder::~EventRecorder() {
+    // A clip being started still uses this object
+    m_pool.waitForDone();
+    stop();
+    if (m_caps) {
+        gst_caps_unref(m_caps);
+    }
+}
+
+GstClockTime EventRecorder::decodeTime(GstBuffer *buffer) {
+    return GST_BUFFER_DTS_IS_VALID(buffer) ? GST_BUFFER_DTS(buffer) : GST_BUFFER_PTS(buffer);
+}
+
+void EventRecorder::setCaps(GstCaps *caps) {
+    QMutexLocker locker(&m_mutex);
+    gst_caps_replace(&m_caps, caps);
+}
+
+void EventRecorder::pushAccessUnit(GstBuffer *buffer) {
+    QMutexLocker locker(&m_mutex);
+
+    // The ring always starts on a keyframe so a clip can start decoding
+    if (!GST_BUFFER_FLAG_IS_SET(buffer, GST_BUFFER_FLAG_DELTA_UNIT)) {
+        m_gops.emplace_back();
+        m_gops.back().start = decodeTime(buffer);
+    } else if (m_gops.empty()) {
+        return;
+    }
+
+    Gop &gop = m_gops.back();
+    gop.units.push_back(gst_buffer_ref(buffer));
+    qint64 size = static_cast<qint64>(gst_buffer_get_size(buffer));
+    gop.bytes += size;
+    m_preRollBytes += size;
+    trimPreRoll();
+
+    if (m_clip) {
+        pushToClip(buffer);
+        qint64 now = m_clock.elapsed();
+        if (now > m_clipDeadlineMs || now - m_clipStartMs > MAX_CLIP_MS) {
+            finishClip();
+        }
+    }
+}
+
+void EventRecorder::trimPreRoll() {
+    // Drop the oldest GOP while the next one alone still covers the pre-roll
+    GstClockTime latest = m_gops.back().start;
+    while (m_gops.size() > 1) {
+        const Gop &next = m_gops[1];
+        bool covered = GST_CLOCK_TIME_IS_VALID(latest) && GST_CLOCK_TIME_IS_VALID(next.start)
+                       && latest >= next.start + PRE_ROLL_MS * GST_MSECOND;
+        if (!covered && m_preRollBytes <= MAX_PRE_ROLL_BYTES) {
+            break;
+        }
+
+        Gop &oldest = m_gops.front();
+        for (GstBuffer *unit : oldest.units) {
+            gst_buffer_unref(unit);
+        }
+        m_preRollBytes -= oldest.bytes;
+        m_gops.pop_front();
+    }
+}
+
+void EventRecorder::clearPreRoll() {
+    for (Gop &gop : m_gops) {
+        for (GstBuffer *unit : gop.units) {
+            gst_buffer_unref(unit);
+        }
+    }
+    m_gops.clear();
+    m_preRollBytes = 0;
+}
+
+GstElement *EventRecorder::createClipPipeline(GstCaps *caps, GstElement **appsrc, QString *path) const {
+    const gchar *media = gst_structure_get_name(gst_caps_get_structure(caps, 0));
+    const char *parserName = g_str_equal(media, "video/x-h265") ? "h265parse" : "h264parse";
+    const char *muxerName = m_container == "mp4" ? "mp4mux"
+                          : m_container == "avi" ? "avimux"
+                                                 : "matroskamux";
+
+    GstElement *pipeline = gst_pipeline_new("event-recorder");
+    GstElement *src = gst_element_factory_make("appsrc", "clip-src");
+    GstElement *parse = gst_element_factory_make(parserName, "clip-parse");
+    GstElement *mux = gst_element_factory_make(muxerName, "clip-mux");
+    GstElement *sink = gst_element_factory_make("filesink", "clip-sink");
+    if (!pipeline || !src || !parse || !mux || !sink) {
+        qCritical() << "Failed to create recording elements" << parserName << muxerName;
+        for (GstElement *element : { pipeline, src, parse, mux, sink }) {
+            if (element) {
+                gst_object_unref(element);
+            }
+        }
+        return nullptr;
+    }
+
+    *path = QString("%1/%2_%3.%4")
+                     .arg(m_outputDir, m_fileStem,
+                          QDateTime::currentDateTime().toString("yyyyMMdd_hhmmss"),
+                          m_container);
+
+    g_object_set(G_OBJECT(src),
+                 "caps", caps,
+                 "format", GST_FORMAT_TIME,
+                 "is-live", FALSE,
+                 "block", FALSE,
+                 "max-bytes", static_cast<guint64>(2 * MAX_PRE_ROLL_BYTES),
+                 nullptr);
+    g_object_set(G_OBJECT(sink),
+                 "location", path->toUtf8().constData(),
+                 "sync", FALSE,
+                 nullptr);
+
+    gst_bin_add_many(GST_BIN(pipeline), src, parse, mux, sink, nullptr);
+    if (!gst_element_link_many(src, parse, mux, sink, nullptr)
+        || gst_element_set_state(pipeline, GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE) {
+        qCritical() << "Failed to start recording to" << *path;
+        gst_element_set_state(pipeline, GST_STATE_NULL);
+        gst_object_unref(pipeline);
+        return nullptr;
+    }
+
+    *appsrc = src;
+    return pipeline;
+}
+
+void EventRecorder::pushToClip(GstBuffer *buffer) {
+    // Shallow copy: shares the memory, only the timestamps are rebased to 0
+    GstBuffer *copy = gst_buffer_copy(buffer);
+    auto rebase = [this](GstClockTime time) {
+        if (!GST_CLOCK_TIME_IS_VALID(time)) {
+            return time;
+        }
+        return time > m_clipBase ? time - m_clipBase : 0;
+    };
+    GST_BUFFER_PTS(copy) = rebase(GST_BUFFER_PTS(copy));
+    GST_BUFFER_DTS(copy) = rebase(GST_BUFFER_DTS(copy));
+
+    gst_app_src_push_buffer(GST_APP_SRC(m_appsrc), copy);
+}
+
+void EventRecorder::trigger() {
+    QMutexLocker locker(&m_mutex);
+    if (m_clip) {
+        m_clipDeadlineMs = m_clock.elapsed() + POST_ROLL_MS;
+        return;
+    }
+
+    if (m_starting || !m_caps || m_gops.empty()) {
+        return;
+    }
+
+    // Building and starting the pipeline takes milliseconds; keep it off the
+    // caller's thread and out of m_mutex, which the streaming thread needs
+    m_starting = true;
+    m_pool.start([this]() { startClip(); });
+}
+
+void EventRecorder::startClip() {
+    GstCaps *caps = nullptr;
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_caps) {
+            caps = gst_caps_ref(m_caps);
+        }
+    }
+
+    GstElement *appsrc = nullptr;
+    GstElement *clip = nullptr;
+    QString path;
+    if (caps) {
+        clip = createClipPipeline(caps, &appsrc, &path);
+        gst_caps_unref(caps);
+    }
+
+    QMutexLocker locker(&m_mutex);
+    m_starting = false;
+    if (!clip) {
+        return;
+    }
+    // Stopped meanwhile: the session this clip was for is gone
+    if (m_gops.empty()) {
+        gst_element_set_state(clip, GST_STATE_NULL);
+        gst_object_unref(clip);
+        return;
+    }
+
+    qint64 now = m_clock.elapsed();
+    m_clip = clip;
+    m_appsrc = appsrc;
+    m_clipPath = path;
+    m_clipBase = m_gops.front().start;
+    m_clipStartMs = now;
+    m_clipDeadlineMs = now + POST_ROLL_MS;
+
+    for (const Gop &gop : m_gops) {
+        for (GstBuffer *unit : gop.units) {
+            pushToClip(unit);
+        }
+    }
+    qDebug() << "Recording" << m_clipPath << "with" << m_preRollBytes / 1024 << "KB pre-roll";
+}
+
+void EventRecorder::finishClip() {
+    gst_app_src_end_of_stream(GST_APP_SRC(m_appsrc));
+
+    // The muxer finalises the file on EOS; wait for that off the streaming
+    // thread
+    GstElement *clip = m_clip;
+    QString path = m_clipPath;
+    QThreadPool::globalInstance()->start([clip, path]() {
+        GstBus *bus = gst_element_get_bus(clip);
+        GstMessage *msg = gst_bus_timed_pop_filtered(bus, FINISH_TIMEOUT_MS * GST_MSECOND,
+                                                     (GstMessageType)(GST_MESSAGE_EOS | GST_MESSAGE_ERROR));
+        if (!msg || GST_MESSAGE_TYPE(msg) == GST_MESSAGE_ERROR) {
+            qCritical() << "Recording did not finish cleanly:" << path;
+        } else {
+            qDebug() << "Recording saved:" << path;
+        }
+        if (msg) {
+            gst_message_unref(msg);
+        }
+        gst_object_unref(bus);
+        gst_element_set_state(clip, GST_STATE_NULL);
+        gst_object_unref(clip);
+    });
+
+    m_clip = nullptr;
+    m_appsrc = nullptr;
+    m_clipCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+void EventRecorder::stop() {
+    QMutexLocker locker(&m_mutex);
+    if (m_clip) {
+        finishClip();
+    }
+    // Timestamps restart with the next session
+    clearPreRoll();
+}
+
+bool EventRecorder::isRecording() const {
+    QMutexLocker locker(&m_mutex);
+    return m_clip != nullptr;
+}
+
+int EventRecorder::clipCount() const {
+    return m_clipCount.load(std::memory_order_relaxed);
+}
+
+qint64 EventRecorder::preRollBytes() const {
+    QMutexLocker locker(&m_mutex);
+    return m_preRollBytes;
+}
@@ -0,0 +1,80 @@
+#ifndef EVENTRECORDER_H
+#define EVENTRECORDER_H
+
+#include <QString>
+#include <QMutex>
+#include <QElapsedTimer>
+#include <QThreadPool>
+#include <atomic>
+#include <deque>
+#include <vector>
+#include <gst/gst.h>
+
+// Detection-triggered clip recording without re-encoding. Parsed access
+// units are held by reference in a GOP-aligned pre-roll ring; trigger()
+// has the recorder's own thread open appsrc ! parse ! mux ! filesink, which
+// gets the ring and then the live units until no trigger came in for
+// POST_ROLL_MS.
+class EventRecorder
+{
+public:
+    static constexpr int PRE_ROLL_MS = 5000;
+    static constexpr int POST_ROLL_MS = 5000;               // After the last trigger
+    static constexpr int MAX_CLIP_MS = 60000;               // Then a new clip starts
+    static constexpr qint64 MAX_PRE_ROLL_BYTES = 32 * 1024 * 1024;
+    static constexpr int FINISH_TIMEOUT_MS = 5000;          // Waiting for the muxer to finalise
+
+    // container: "mp4", "mkv" or "avi"; fileStem names the stream
+    EventRecorder(const QString &outputDir, const QString &fileStem, const QString &container);
+    ~EventRecorder();
+
+    // Streaming thread. Takes its own reference of the buffer.
+    void setCaps(GstCaps *caps);
+    void pushAccessUnit(GstBuffer *buffer);
+
+    // Any thread; only extends the open clip or posts its start
+    void trigger();
+    void stop();
+
+    bool isRecording() const;
+    int clipCount() const;
+    qint64 preRollBytes() const;
+
+private:
+    struct Gop {
+        std::vector<GstBuffer*> units;
+        GstClockTime start = GST_CLOCK_TIME_NONE;
+        qint64 bytes = 0;
+    };
+
+    void startClip();
+    GstElement *createClipPipeline(GstCaps *caps, GstElement **appsrc, QString *path) const;
+    void pushToClip(GstBuffer *buffer);      // Caller holds m_mutex
+    void finishClip();                       // Caller holds m_mutex
+    void trimPreRoll();                      // Caller holds m_mutex
+    void clearPreRoll();
+    static GstClockTime decodeTime(GstBuffer *buffer);
+
+    QString m_outputDir;
+    QString m_fileStem;
+    QString m_container;
+
+    mutable QMutex m_mutex;
+    GstCaps *m_caps = nullptr;
+    std::deque<Gop> m_gops;
+    qint64 m_preRollBytes = 0;
+
+    bool m_starting = false;                 // startClip is queued or running
+    GstElement *m_clip = nullptr;            // Recording pipeline while a clip is open
+    GstElement *m_appsrc = nullptr;
+    GstClockTime m_clipBase = GST_CLOCK_TIME_NONE;
+    qint64 m_clipStartMs = 0;
+    qint64 m_clipDeadlineMs = 0;
+    QString m_clipPath;
+
+    QElapsedTimer m_clock;
+    std::atomic<int> m_clipCount{0};
+    QThreadPool m_pool;                      // Builds clip pipelines off the callers' threads
+};
+
+#endif // EVENTRECORDER_H
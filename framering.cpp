@@ -0,0 +1,128 @@
+#include "framering.h"
+#include <cstddef>
+#include <thread>
+
+static size_t roundUpToPowerOfTwo(int value) {
+    size_t size = 1;
+    while (size < static_cast<size_t>(value)) {
+        size <<= 1;
+    }
+    return size;
+}
+
+FrameRing::FrameRing(int capacity, DropPolicy policy)
+    : m_slots(roundUpToPowerOfTwo(qMax(1, capacity)))
+    , m_mask(m_slots.size() - 1)
+    , m_policy(policy) {
+
+    for (size_t i = 0; i < m_slots.size(); ++i) {
+        m_slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+bool FrameRing::push(const VideoFrame &frame) {
+    m_pushed.fetch_add(1, std::memory_order_relaxed);
+
+    size_t tail = m_tail.load(std::memory_order_relaxed);
+    Slot *slot = &m_slots[tail & m_mask];
+
+    while (slot->sequence.load(std::memory_order_acquire) != tail) {
+        // Full
+        if (m_policy == DropNewest) {
+            m_overruns.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        // Evict the oldest frame. If the consumer is mid-pop on it, the
+        // slot frees up within a handle move; just retry.
+        VideoFrame evicted;
+        if (take(evicted)) {
+            m_overruns.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            std::this_thread::yield();
+        }
+    }
+
+    slot->frame = frame;
+    slot->sequence.store(tail + 1, std::memory_order_release);
+    m_tail.store(tail + 1, std::memory_order_relaxed);
+
+    // Pairs with the fence in requestWakeup(): either the consumer sees this
+    // frame, or we see its request
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    return m_wakeRequested.load(std::memory_order_relaxed)
+           && m_wakeRequested.exchange(false, std::memory_order_acq_rel);
+}
+
+bool FrameRing::take(VideoFrame &frame) {
+    // Claimed by CAS since the producer also takes under DropOldest
+    size_t head = m_head.load(std::memory_order_relaxed);
+    for (;;) {
+        Slot *slot = &m_slots[head & m_mask];
+        size_t sequence = slot->sequence.load(std::memory_order_acquire);
+        std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(head + 1);
+
+        if (diff == 0) {
+            if (m_head.compare_exchange_weak(head, head + 1, std::memory_order_relaxed)) {
+                // Move out so the ring does not keep the buffer referenced
+                frame = std::move(slot->frame);
+                slot->frame = VideoFrame();
+                slot->sequence.store(head + m_slots.size(), std::memory_order_release);
+                return true;
+            }
+        } else if (diff < 0) {
+            return false;   // Empty
+        } else {
+            head = m_head.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+bool FrameRing::pop(VideoFrame &frame) {
+    return take(frame);
+}
+
+bool FrameRing::popLatest(VideoFrame &frame) {
+    if (!take(frame)) {
+        return false;
+    }
+
+    VideoFrame newer;
+    while (take(newer)) {
+        frame = std::move(newer);
+        m_overruns.fetch_add(1, std::memory_order_relaxed);
+    }
+    return true;
+}
+
+void FrameRing::clear() {
+    VideoFrame frame;
+    while (take(frame)) {
+    }
+}
+
+void FrameRing::requestWakeup() {
+    m_wakeRequested.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+bool FrameRing::isEmpty() const {
+    size_t head = m_head.load(std::memory_order_acquire);
+    return m_slots[head & m_mask].sequence.load(std::memory_order_acquire) != head + 1;
+}
+
+int FrameRing::capacity() const {
+    return static_cast<int>(m_slots.size());
+}
+
+FrameRing::DropPolicy FrameRing::policy() const {
+    return m_policy;
+}
+
+quint64 FrameRing::pushed() const {
+    return m_pushed.load(std::memory_order_relaxed);
+}
+
+quint64 FrameRing::overruns() const {
+    return m_overruns.load(std::memory_order_relaxed);
+}
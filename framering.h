@@ -0,0 +1,67 @@
+#ifndef FRAMERING_H
+#define FRAMERING_H
+
+#include <atomic>
+#include <vector>
+#include "videoframe.h"
+
+// Fixed-capacity single-producer/single-consumer ring of VideoFrame handles.
+// Slots are allocated once; push and pop only move refcounted handles, so the
+// streaming thread never allocates or takes a lock. When full, DropOldest
+// evicts the oldest queued frame and DropNewest rejects the incoming one;
+// both count an overrun.
+//
+// Each slot carries a sequence number (Vyukov's bounded queue), which lets the
+// producer evict from the consumer end under DropOldest without a mutex.
+class FrameRing
+{
+public:
+    enum DropPolicy {
+        DropOldest = 0,     // Freshest frames win, for live video
+        DropNewest          // Queued frames win, e.g. for recording
+    };
+
+    // Capacity is rounded up to a power of two
+    explicit FrameRing(int capacity, DropPolicy policy = DropOldest);
+
+    FrameRing(const FrameRing &) = delete;
+    FrameRing &operator=(const FrameRing &) = delete;
+
+    // Producer. Returns true when the consumer asked to be woken for this push.
+    bool push(const VideoFrame &frame);
+
+    // Consumer. popLatest discards everything but the newest frame.
+    bool pop(VideoFrame &frame);
+    bool popLatest(VideoFrame &frame);
+    void clear();
+
+    // Consumer: have the next push report a wake-up. Call before checking for
+    // emptiness so a frame pushed in between is not missed.
+    void requestWakeup();
+
+    bool isEmpty() const;
+    int capacity() const;
+    DropPolicy policy() const;
+    quint64 pushed() const;     // Every push, including rejected ones
+    quint64 overruns() const;   // Frames dropped by either policy or popLatest
+
+private:
+    struct Slot {
+        std::atomic<size_t> sequence{0};
+        VideoFrame frame;
+    };
+
+    bool take(VideoFrame &frame);
+
+    std::vector<Slot> m_slots;
+    size_t m_mask;
+    DropPolicy m_policy;
+
+    alignas(64) std::atomic<size_t> m_head{0};     // Next slot to pop
+    alignas(64) std::atomic<size_t> m_tail{0};     // Next slot to push, producer only
+    alignas(64) std::atomic<bool> m_wakeRequested{true};
+    std::atomic<quint64> m_pushed{0};
+    std::atomic<quint64> m_overruns{0};
+};
+
+#endif // FRAMERING_H
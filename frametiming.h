@@ -0,0 +1,52 @@
+#ifndef FRAMETIMING_H
+#define FRAMETIMING_H
+
+#include <QtGlobal>
+
+// Steady-clock timestamps (ns, VideoFrame::nowNs()) of one frame on its way
+// from the camera to the screen. 0 means the stage was not reached or not
+// measured for this frame.
+struct FrameTiming {
+    enum Stage {
+        Source = 0,         // Packet entered rtspsrc (from the buffer PTS)
+        Decoded,            // Left the decoder
+        Sampled,            // Reached the appsink, scaled and converted
+        Dispatched,         // Handed to a detection worker
+        InferenceStart,     // Worker picked it up
+        InferenceEnd,       // Detections ready
+        Delivered,          // Result reached the GUI thread
+        Displayed,          // Painted on screen
+        StageCount
+    };
+
+    qint64 ptsNs = -1;      // Buffer PTS, -1 when unknown
+    qint64 stamps[StageCount] = {};
+
+    qint64 at(Stage stage) const { return stamps[stage]; }
+
+    // ms between two stages, -1 when either is missing
+    double spanMs(Stage from, Stage to) const {
+        if (stamps[from] <= 0 || stamps[to] <= 0) {
+            return -1.0;
+        }
+        return (stamps[to] - stamps[from]) / 1e6;
+    }
+
+    // First stage that was stamped; Source for RTSP, Sampled for files
+    Stage firstStage() const {
+        for (int s = 0; s < StageCount; ++s) {
+            if (stamps[s] > 0) {
+                return static_cast<Stage>(s);
+            }
+        }
+        return StageCount;
+    }
+
+    static const char *stageName(Stage stage) {
+        static const char *names[] = { "source", "decoded", "sampled", "dispatched",
+                                       "infer start", "infer end", "delivered", "displayed" };
+        return stage < StageCount ? names[stage] : "";
+    }
+};
+
+#endif // FRAMETIMING_H
@@ -5,30 +5,47 @@
 #include <QStandardPaths>
 #include <QDir>
 #include <QRegularExpression>
+#include <QRandomGenerator>
+#include <mutex>
 #include <gst/video/video.h>
 
 GStreamerRtsp::GStreamerRtsp(QObject *parent)
     : QThread(parent)
-    , m_outputFormat("avi"){
+    , m_outputFormat("mkv")
+    , m_displayRing(new FrameRing(DEFAULT_RING_CAPACITY, FrameRing::DropOldest))
+    , m_detectionRing(new FrameRing(DEFAULT_RING_CAPACITY, FrameRing::DropOldest)) {
 
-    QString appDir = QString(EXPAND(PROJECT_PATH));
-
-    //QString exePath = QCoreApplication::applicationDirPath();
-    QString binPath = appDir;
-    QString pluginPath = appDir + "/gstreamer-1.0";
-
-    // Add both paths to system PATH
-    QString path = qgetenv("PATH");
-    path = binPath + ";" + appDir + ";" + path;
-    qputenv("PATH", path.toLocal8Bit());
-
-    // Set GStreamer specific environment variables
-    qputenv("GST_PLUGIN_PATH", pluginPath.toLocal8Bit());
-    qputenv("GST_PLUGIN_SYSTEM_PATH", pluginPath.toLocal8Bit());
-    qputenv("GST_PLUGIN_SCANNER_PATH", binPath.toLocal8Bit());
+    initializeGStreamer();
+    m_clock.start();
+}
 
-    gst_init(nullptr, nullptr);
-    qDebug() << "GStreamer version:" << gst_version_string();
+void GStreamerRtsp::initializeGStreamer() {
+    // Process-wide setup, done once however many streams are created
+    static std::once_flag once;
+    std::call_once(once, []() {
+#ifdef Q_OS_WIN
+        // The bundled plugins are Windows DLLs
+        QString appDir = QString(EXPAND(PROJECT_PATH));
+
+        //QString exePath = QCoreApplication::applicationDirPath();
+        QString binPath = appDir;
+        QString pluginPath = appDir + "/gstreamer-1.0";
+
+        // Add both paths to system PATH
+        QString path = qgetenv("PATH");
+        path = binPath + ";" + appDir + ";" + path;
+        qputenv("PATH", path.toLocal8Bit());
+
+        // Set GStreamer specific environment variables
+        qputenv("GST_PLUGIN_PATH", pluginPath.toLocal8Bit());
+        qputenv("GST_PLUGIN_SYSTEM_PATH", pluginPath.toLocal8Bit());
+        qputenv("GST_PLUGIN_SCANNER_PATH", binPath.toLocal8Bit());
+#endif
+
+        gst_init(nullptr, nullptr);
+        gst_debug_set_default_threshold(GST_LEVEL_WARNING);
+        qDebug() << "GStreamer version:" << gst_version_string();
+    });
 }
 
 GStreamerRtsp::~GStreamerRtsp() {
@@ -73,23 +90,110 @@ QString GStreamerRtsp::serverIP() const {
     return m_serverIP;
 }
 
-bool GStreamerRtsp::initialize() {
-    // Enable debug output
-    gst_debug_set_default_threshold(GST_LEVEL_WARNING);
+void GStreamerRtsp::setDecodeLevel(DecodeLevel level) {
+    int previous = m_decodeLevel.exchange(level, std::memory_order_acq_rel);
+    if (previous != level) {
+        qDebug() << "Decode level for" << getUrl() << "changed from" << previous << "to" << level;
+    }
+}
+
+GStreamerRtsp::DecodeLevel GStreamerRtsp::decodeLevel() const {
+    return static_cast<DecodeLevel>(m_decodeLevel.load(std::memory_order_acquire));
+}
+
+void GStreamerRtsp::setDisplayMaxFps(int fps) {
+    m_displayMaxFps = qMax(0, fps);
+}
+
+void GStreamerRtsp::setDisplayRing(int capacity, FrameRing::DropPolicy policy) {
+    m_displayRing.reset(new FrameRing(capacity, policy));
+}
+
+void GStreamerRtsp::setDetectionRing(int capacity, FrameRing::DropPolicy policy) {
+    m_detectionRing.reset(new FrameRing(capacity, policy));
+}
+
+FrameRing *GStreamerRtsp::displayRing() const {
+    return m_displayRing.get();
+}
+
+FrameRing *GStreamerRtsp::detectionRing() const {
+    return m_detectionRing.get();
+}
+
+void GStreamerRtsp::setPullMode(bool enabled) {
+    m_pullMode = enabled;
+}
+
+bool GStreamerRtsp::pullMode() const {
+    return m_pullMode;
+}
+
+void GStreamerRtsp::setRecording(const QString &outputDir, const QString &container) {
+    m_recordDir = outputDir;
+    if (!container.isEmpty()) {
+        m_outputFormat = container;
+    }
+
+    // Created here, before any streaming thread exists, and never replaced
+    // while running, so those threads read m_recorder without a lock. It
+    // outlives pipeline rebuilds; its ring is per session.
+    m_recorder.reset(m_recordDir.isEmpty()
+                         ? nullptr
+                         : new EventRecorder(m_recordDir, modifyRtspUrl(m_inFilename), m_outputFormat));
+}
+
+void GStreamerRtsp::triggerRecording() {
+    if (m_recorder) {
+        m_recorder->trigger();
+    }
+}
+
+int GStreamerRtsp::recordedClips() const {
+    return m_recorder ? m_recorder->clipCount() : 0;
+}
+
+quint64 GStreamerRtsp::decoderSkippedFrames() const {
+    return m_decoderSkipped.load(std::memory_order_relaxed);
+}
+
+int GStreamerRtsp::reconnectCount() const {
+    return m_reconnectCount.load(std::memory_order_relaxed);
+}
+
+qint64 GStreamerRtsp::lastRecoveryMs() const {
+    return m_lastRecoveryMs.load(std::memory_order_relaxed);
+}
 
+qint64 GStreamerRtsp::timeToFirstFrameMs() const {
+    return m_timeToFirstFrameMs.load(std::memory_order_relaxed);
+}
+
+bool GStreamerRtsp::initialize() {
     m_pipeline = gst_pipeline_new("rtsp-player");
 
-    // Create elements for the pipeline
+    // Create elements for the pipeline. The decoder feeds a tee with two
+    // branches: BGR for display, the decoder's native YUV for detection.
     GstElement *source = gst_element_factory_make("rtspsrc", "source");
+    GstElement *tee = gst_element_factory_make("tee", "tee");
+    GstElement *displayQueue = gst_element_factory_make("queue", "display-queue");
+    GstElement *displayRate = m_displayMaxFps > 0 ? gst_element_factory_make("videorate", "display-rate") : nullptr;
     GstElement *convert = gst_element_factory_make("videoconvert", "convert");
     m_videoSink = gst_element_factory_make("appsink", "video-output");
+    GstElement *detectQueue = gst_element_factory_make("queue", "detect-queue");
+    GstElement *detectConvert = gst_element_factory_make("videoconvert", "detect-convert");
+    m_detectionSink = gst_element_factory_make("appsink", "detect-output");
 
     // Check if elements were created successfully
-    if (!m_pipeline || !source || !convert || !m_videoSink) {
+    if (!m_pipeline || !source || !tee || !displayQueue || !convert || !m_videoSink ||
+        !detectQueue || !detectConvert || !m_detectionSink ||
+        (m_displayMaxFps > 0 && !displayRate)) {
         qDebug() << "One or more elements could not be created";
         if (!source) qDebug() << "Failed to create source";
-        if (!convert) qDebug() << "Failed to create convert";
-        if (!m_videoSink) qDebug() << "Failed to create video sink";
+        if (!tee) qDebug() << "Failed to create tee";
+        if (!convert || !detectConvert) qDebug() << "Failed to create convert";
+        if (m_displayMaxFps > 0 && !displayRate) qDebug() << "Failed to create videorate";
+        if (!m_videoSink || !m_detectionSink) qDebug() << "Failed to create video sink";
         return false;
     }
 
@@ -106,39 +210,94 @@ bool GStreamerRtsp::initialize() {
                  "drop-on-latency", TRUE,
                  nullptr);
 
-    // Configure appsink
+    // Each branch runs in its own thread and never holds back the other
+    for (GstElement *queue : { displayQueue, detectQueue }) {
+        g_object_set(G_OBJECT(queue),
+                     "max-size-buffers", 1,
+                     "max-size-bytes", 0,
+                     "max-size-time", (guint64)0,
+                     "leaky", 2,  // Downstream: drop the oldest buffer
+                     nullptr);
+    }
+
+    if (displayRate) {
+        g_object_set(G_OBJECT(displayRate),
+                     "max-rate", m_displayMaxFps,
+                     "drop-only", TRUE,
+                     nullptr);
+    }
+
+    // Configure appsinks
     GstCaps *appsink_caps = gst_caps_new_simple("video/x-raw",
                                                 "format", G_TYPE_STRING, "BGR",
                                                 nullptr);
     gst_app_sink_set_caps(GST_APP_SINK(m_videoSink), appsink_caps);
     gst_caps_unref(appsink_caps);
 
-    g_object_set(G_OBJECT(m_videoSink),
-                 "emit-signals", TRUE,
-                 "sync", FALSE,
-                 "drop", TRUE,
-                 "max-buffers", 1,
-                 nullptr);
+    // The detector converts and scales YUV itself in one pass. avdec
+    // outputs I420 or NV12 for 8-bit 4:2:0 streams, which videoconvert
+    // passes through untouched; it only converts anything else.
+    GstCaps *detect_caps = gst_caps_from_string("video/x-raw,format=(string){ I420, NV12 }");
+    gst_app_sink_set_caps(GST_APP_SINK(m_detectionSink), detect_caps);
+    gst_caps_unref(detect_caps);
+
+    // In pull mode the appsink is the handoff queue, deep enough for one
+    // puller batch; callbacks keep a single buffer
+    for (GstElement *sink : { m_videoSink, m_detectionSink }) {
+        g_object_set(G_OBJECT(sink),
+                     "emit-signals", m_pullMode ? FALSE : TRUE,
+                     "sync", FALSE,
+                     "drop", TRUE,
+                     "max-buffers", m_pullMode ? AppSinkPuller::MAX_BATCH : 1,
+                     nullptr);
+    }
 
     // Add elements to pipeline
-    gst_bin_add_many(GST_BIN(m_pipeline), source, convert, m_videoSink, nullptr);
+    gst_bin_add_many(GST_BIN(m_pipeline), source, tee,
+                     displayQueue, convert, m_videoSink,
+                     detectQueue, detectConvert, m_detectionSink, nullptr);
+    if (displayRate) {
+        gst_bin_add(GST_BIN(m_pipeline), displayRate);
+    }
+
+    // We'll link the decoder dynamically in the pad-added callback
+    // Only link the tee branches now
+    bool linked = displayRate
+                      ? gst_element_link_many(tee, displayQueue, displayRate, convert, m_videoSink, nullptr)
+                      : gst_element_link_many(tee, displayQueue, convert, m_videoSink, nullptr);
+    if (!linked) {
+        qDebug() << "Failed to link display branch";
+        return false;
+    }
 
-    // We'll link elements dynamically in the pad-added callback
-    // Only link convert -> videosink now
-    if (!gst_element_link(convert, m_videoSink)) {
-        qDebug() << "Failed to link convert -> videosink";
+    if (!gst_element_link_many(tee, detectQueue, detectConvert, m_detectionSink, nullptr)) {
+        qDebug() << "Failed to link detection branch";
         return false;
     }
 
     // Store elements as member variables if needed later
     m_source = source;
+    m_tee = tee;
     m_converter = convert;
 
+    // Decoder output enters the tee; note when, per PTS, for frame timing
+    GstPad *tee_sink = gst_element_get_static_pad(tee, "sink");
+    gst_pad_add_probe(tee_sink, GST_PAD_PROBE_TYPE_BUFFER, decoded_probe, this, nullptr);
+    gst_object_unref(tee_sink);
+
     // Connect pad-added signal for dynamic linking
     g_signal_connect(source, "pad-added", G_CALLBACK(on_pad_added), this);
 
-    // Connect new-sample signal for appsink
-    g_signal_connect(m_videoSink, "new-sample", G_CALLBACK(cb_new_sample), this);
+    // Caps negotiation on the display sink signals readiness
+    GstPad *sink_pad = gst_element_get_static_pad(m_videoSink, "sink");
+    g_signal_connect(sink_pad, "notify::caps", G_CALLBACK(on_caps_notify), this);
+    gst_object_unref(sink_pad);
+
+    // Connect new-sample signal for both appsinks
+    if (!m_pullMode) {
+        g_signal_connect(m_videoSink, "new-sample", G_CALLBACK(cb_new_sample), this);
+        g_signal_connect(m_detectionSink, "new-sample", G_CALLBACK(cb_new_sample), this);
+    }
 
     qDebug() << "Pipeline initialized successfully";
     return true;
@@ -146,8 +305,16 @@ bool GStreamerRtsp::initialize() {
 
 void GStreamerRtsp::startStreamer() {
 
-    if (!initialize()) {
+    // The pipeline survives reconnects; rebuild it only when there is none
+    // yet or reusing it keeps failing
+    if (m_pipeline && m_consecutiveFailures.load(std::memory_order_acquire) >= REBUILD_AFTER_FAILURES) {
+        qDebug() << "Rebuilding pipeline after" << m_consecutiveFailures.load() << "failed reconnects";
+        cleanup();
+    }
+
+    if (!m_pipeline && !initialize()) {
         qDebug() << "Failed to initialize GStreamer pipeline";
+        cleanup();
         return;
     }
 
@@ -156,57 +323,23 @@ void GStreamerRtsp::startStreamer() {
 
     qDebug() << "Setting pipeline to PLAYING state...";
 
-    // First set to NULL state to ensure clean start
-    gst_element_set_state(m_pipeline, GST_STATE_NULL);
-    QThread::msleep(100);
-
-    // Then set to READY state
-    GstStateChangeReturn ret = gst_element_set_state(m_pipeline, GST_STATE_READY);
-    if (ret == GST_STATE_CHANGE_FAILURE) {
-        qDebug() << "Failed to set pipeline to READY";
-        cleanup();
-        m_isStreaming.store(false, std::memory_order_release);
-        m_isRunning.store(false, std::memory_order_release);
-        return;
-    }
-
-    QThread::msleep(100);
-
-    // Finally set to PLAYING state
-    ret = gst_element_set_state(m_pipeline, GST_STATE_PLAYING);
-
-    // Wait for state change with longer timeout
-    GstState current, pending;
-    ret = gst_element_get_state(m_pipeline, &current, &pending, 5 * GST_SECOND);
-
+    // Start asynchronously. rtspsrc negotiates in the background and the
+    // appsink caps notification reports the video parameters; nothing here
+    // blocks, so many streams come up in parallel.
+    m_startMs.store(m_clock.elapsed(), std::memory_order_release);
+    GstStateChangeReturn ret = gst_element_set_state(m_pipeline, GST_STATE_PLAYING);
     if (ret == GST_STATE_CHANGE_FAILURE) {
-        qDebug() << "Failed to reach PLAYING state";
+        qDebug() << "Failed to set pipeline to PLAYING";
         cleanup();
         m_isStreaming.store(false, std::memory_order_release);
-        m_isRunning.store(false, std::memory_order_release);
         return;
     }
 
-    qDebug() << "Pipeline is now playing";
-
-    // Wait a bit for dimensions and fps if not available
-    int timeout = 0;
-    while ((m_width == 0 || m_height == 0 || m_fps == 0) && timeout < 50) {
-        QThread::msleep(100);
-        timeout++;
-        qDebug() << "Waiting for video parameters..." << timeout
-                 << "Current dimensions:" << m_width << "x" << m_height
-                 << "FPS:" << m_fps;
-    }
-
-    // If we have all parameters after the loop, set the flag
-    if (m_width > 0 && m_height > 0 && m_fps > 0) {
-        m_parametersDetected.store(true, std::memory_order_release);
-        qDebug() << "Video parameters locked";
-    }
+    startPullers();
 
     m_lastFpsUpdateTime = std::chrono::steady_clock::now();
     m_frameCount = 0;
+    m_lastFrameMs.store(m_clock.elapsed(), std::memory_order_release);
 
     // Main loop for handling messages
     GstBus* bus = gst_element_get_bus(m_pipeline);
@@ -250,16 +383,27 @@ void GStreamerRtsp::startStreamer() {
             }
             gst_message_unref(msg);
         }
+
+        // A silent camera is a failure too, rtspsrc does not always report it.
+        // Connecting gets more time than an established stream.
+        qint64 silentMs = m_clock.elapsed() - m_lastFrameMs.load(std::memory_order_acquire);
+        int timeoutMs = m_connected.load(std::memory_order_acquire) ? STALL_TIMEOUT_MS : FIRST_FRAME_TIMEOUT_MS;
+        if (!m_stop.load(std::memory_order_acquire) && silentMs > timeoutMs) {
+            qDebug() << "No frames for" << silentMs << "ms from" << getUrl();
+            m_stop.store(true, std::memory_order_release);
+        }
     }
 
     gst_object_unref(bus);
 
-    cleanup();
-    m_isStreaming.store(false, std::memory_order_release);
-
-    if (m_stop.load(std::memory_order_acquire) && !m_stopUser.load(std::memory_order_acquire)) {
-        run();
+    // Stop the pipeline but keep its elements for the next attempt. The
+    // flush also releases pullers waiting on the appsinks.
+    gst_element_set_state(m_pipeline, GST_STATE_NULL);
+    stopPullers();
+    if (m_recorder) {
+        m_recorder->stop();
     }
+    m_isStreaming.store(false, std::memory_order_release);
 }
 
 void GStreamerRtsp::on_pad_added(GstElement *src, GstPad *new_pad, gpointer user_data) {
@@ -306,28 +450,82 @@ void GStreamerRtsp::on_pad_added(GstElement *src, GstPad *new_pad, gpointer user
         return;
     }
 
+    // The decode chain survives reconnects; relink it to the new rtspsrc pad
+    // as long as the codec did not change
+    bool h265 = g_str_equal(encoding_name, "H265");
+    if (self->m_depay && (h265 || g_str_equal(encoding_name, "H264"))) {
+        if (self->m_isH265 == h265) {
+            GstPad *sink_pad = gst_element_get_static_pad(self->m_depay, "sink");
+            if (gst_pad_is_linked(sink_pad) || GST_PAD_LINK_FAILED(gst_pad_link(new_pad, sink_pad))) {
+                qDebug() << "Failed to relink pads for codec:" << encoding_name;
+            } else {
+                qDebug() << "Reusing decode chain for codec:" << encoding_name;
+                self->m_waitForKeyframe.store(true, std::memory_order_release);
+            }
+            gst_object_unref(sink_pad);
+            gst_caps_unref(new_pad_caps);
+            return;
+        }
+
+        qDebug() << "Codec changed, replacing decode chain";
+        self->removeDecodeChain();
+    }
+
     // Create appropriate elements based on detected codec
     GstElement *depay = nullptr;
     GstElement *parse = nullptr;
     GstElement *decoder = nullptr;
 
+    const gchar *parsedCaps = nullptr;
+
     if (g_str_equal(encoding_name, "H264")) {
         depay = gst_element_factory_make("rtph264depay", "depay");
         parse = gst_element_factory_make("h264parse", "parse");
         decoder = gst_element_factory_make("avdec_h264", "decoder");
+        parsedCaps = "video/x-h264,stream-format=byte-stream,alignment=au";
+        self->m_isH265 = false;
     } else if (g_str_equal(encoding_name, "H265")) {
         depay = gst_element_factory_make("rtph265depay", "depay");
         parse = gst_element_factory_make("h265parse", "parse");
         decoder = gst_element_factory_make("avdec_h265", "decoder");
+        parsedCaps = "video/x-h265,stream-format=byte-stream,alignment=au";
+        self->m_isH265 = true;
     } else {
         qDebug() << "Unsupported codec:" << encoding_name;
         gst_caps_unref(new_pad_caps);
         return;
     }
 
-    // Add and link the new elements
+    // Add and link the new elements. The parser is pinned to byte-stream
+    // access units so the decoder probe can inspect NAL headers.
     gst_bin_add_many(GST_BIN(self->m_pipeline), depay, parse, decoder, nullptr);
-    gst_element_link_many(depay, parse, decoder, self->m_converter, nullptr);
+    GstCaps *filter = gst_caps_from_string(parsedCaps);
+    gst_element_link(depay, parse);
+    gst_element_link_filtered(parse, decoder, filter);
+    gst_element_link(decoder, self->m_tee);
+    gst_caps_unref(filter);
+
+    // Parsed, still compressed access units feed the recorder. A src pad
+    // probe runs before the decoder probe, so it sees every unit, and the
+    // parser repeats SPS/PPS so clips can start at any keyframe.
+    if (self->m_recorder) {
+        g_object_set(G_OBJECT(parse), "config-interval", -1, nullptr);
+        GstPad *parse_src = gst_element_get_static_pad(parse, "src");
+        gst_pad_add_probe(parse_src,
+                          (GstPadProbeType)(GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM),
+                          parser_probe, self, nullptr);
+        gst_object_unref(parse_src);
+    }
+
+    // Drop access units before they are decoded when the decode level asks for it
+    GstPad *decoder_sink = gst_element_get_static_pad(decoder, "sink");
+    gst_pad_add_probe(decoder_sink, GST_PAD_PROBE_TYPE_BUFFER, decoder_probe, self, nullptr);
+    gst_object_unref(decoder_sink);
+    self->m_depay = depay;
+    self->m_parser = parse;
+    self->m_decoder = decoder;
+    self->m_waitForKeyframe.store(true, std::memory_order_release);
+
     gst_element_sync_state_with_parent(depay);
     gst_element_sync_state_with_parent(parse);
     gst_element_sync_state_with_parent(decoder);
@@ -345,6 +543,186 @@ void GStreamerRtsp::on_pad_added(GstElement *src, GstPad *new_pad, gpointer user
     gst_caps_unref(new_pad_caps);
 }
 
+void GStreamerRtsp::on_caps_notify(GstPad *pad, GParamSpec *pspec, gpointer user_data) {
+    Q_UNUSED(pspec);
+    GStreamerRtsp *self = static_cast<GStreamerRtsp*>(user_data);
+    GstCaps *caps = gst_pad_get_current_caps(pad);
+    if (!caps) {
+        return;
+    }
+
+    GstStructure *str = gst_caps_get_structure(caps, 0);
+    gint width, height;
+    gint fps_n = 0, fps_d = 0;
+    if (gst_structure_get_int(str, "width", &width) &&
+        gst_structure_get_int(str, "height", &height)) {
+        self->m_width = width;
+        self->m_height = height;
+
+        // Live sources often report 0/1; fall back to 25 like elsewhere
+        gst_structure_get_fraction(str, "framerate", &fps_n, &fps_d);
+        self->m_fps = (fps_n > 0 && fps_d != 0) ? (fps_n / fps_d) : 25;
+
+        self->m_parametersDetected.store(true, std::memory_order_release);
+        qDebug() << "Video parameters negotiated:" << width << "x" << height
+                 << "FPS:" << self->m_fps << "(fraction:" << fps_n << "/" << fps_d << ")";
+        emit self->streamReady(width, height, self->m_fps);
+    }
+
+    gst_caps_unref(caps);
+}
+
+GstPadProbeReturn GStreamerRtsp::decoder_probe(GstPad *pad, GstPadProbeInfo *info, gpointer user_data) {
+    Q_UNUSED(pad);
+    GStreamerRtsp *self = static_cast<GStreamerRtsp*>(user_data);
+    GstBuffer *buffer = GST_PAD_PROBE_INFO_BUFFER(info);
+    if (!buffer) {
+        return GST_PAD_PROBE_OK;
+    }
+
+    if (!GST_BUFFER_FLAG_IS_SET(buffer, GST_BUFFER_FLAG_DELTA_UNIT)) {
+        // Keyframes are always decoded and end any resync wait
+        self->m_waitForKeyframe.store(false, std::memory_order_release);
+        return GST_PAD_PROBE_OK;
+    }
+
+    int level = self->m_decodeLevel.load(std::memory_order_acquire);
+
+    // Once a delta unit has been dropped, its dependants are useless until
+    // the next keyframe, even if the level has been lowered meanwhile
+    if (level >= DecodeKeyframesOnly || self->m_waitForKeyframe.load(std::memory_order_acquire)) {
+        self->m_waitForKeyframe.store(true, std::memory_order_release);
+        self->m_decoderSkipped.fetch_add(1, std::memory_order_relaxed);
+        return GST_PAD_PROBE_DROP;
+    }
+
+    // Nothing references a non-reference frame, dropping it is always safe
+    if (level == DecodeReferenceOnly && isNonReferenceUnit(buffer, self->m_isH265)) {
+        self->m_decoderSkipped.fetch_add(1, std::memory_order_relaxed);
+        return GST_PAD_PROBE_DROP;
+    }
+
+    return GST_PAD_PROBE_OK;
+}
+
+GstPadProbeReturn GStreamerRtsp::parser_probe(GstPad *pad, GstPadProbeInfo *info, gpointer user_data) {
+    Q_UNUSED(pad);
+    GStreamerRtsp *self = static_cast<GStreamerRtsp*>(user_data);
+    if (!self->m_recorder) {
+        return GST_PAD_PROBE_OK;
+    }
+
+    if (GST_PAD_PROBE_INFO_TYPE(info) & GST_PAD_PROBE_TYPE_BUFFER) {
+        if (GstBuffer *buffer = GST_PAD_PROBE_INFO_BUFFER(info)) {
+            self->m_recorder->pushAccessUnit(buffer);
+        }
+    } else if (GstEvent *event = GST_PAD_PROBE_INFO_EVENT(info)) {
+        if (GST_EVENT_TYPE(event) == GST_EVENT_CAPS) {
+            GstCaps *caps = nullptr;
+            gst_event_parse_caps(event, &caps);
+            self->m_recorder->setCaps(caps);
+        }
+    }
+    return GST_PAD_PROBE_OK;
+}
+
+GstPadProbeReturn GStreamerRtsp::decoded_probe(GstPad *pad, GstPadProbeInfo *info, gpointer user_data) {
+    Q_UNUSED(pad);
+    GStreamerRtsp *self = static_cast<GStreamerRtsp*>(user_data);
+    GstBuffer *buffer = GST_PAD_PROBE_INFO_BUFFER(info);
+    if (buffer && GST_BUFFER_PTS_IS_VALID(buffer)) {
+        QMutexLocker locker(&self->m_decodeTimesMutex);
+        DecodeTime &slot = self->m_decodeTimes[self->m_decodeTimeNext];
+        slot.pts = GST_BUFFER_PTS(buffer);
+        slot.ns = VideoFrame::nowNs();
+        self->m_decodeTimeNext = (self->m_decodeTimeNext + 1) % DECODE_TIME_SLOTS;
+    }
+    return GST_PAD_PROBE_OK;
+}
+
+void GStreamerRtsp::stampTiming(const VideoFrame &frame, GstSample *sample) {
+    GstBuffer *buffer = gst_sample_get_buffer(sample);
+    if (!buffer || !GST_BUFFER_PTS_IS_VALID(buffer)) {
+        return;
+    }
+
+    GstClockTime pts = GST_BUFFER_PTS(buffer);
+    frame.setPts(static_cast<qint64>(pts));
+
+    // Scale and convert keep the PTS, so it finds the decoder output time
+    {
+        QMutexLocker locker(&m_decodeTimesMutex);
+        for (const DecodeTime &slot : m_decodeTimes) {
+            if (slot.pts == pts) {
+                frame.stamp(FrameTiming::Decoded, slot.ns);
+                break;
+            }
+        }
+    }
+
+    // rtpjitterbuffer timestamps buffers with their arrival running time.
+    // How far the pipeline clock has moved past that is how long ago the
+    // packet came in; map it onto the steady clock of the other stamps.
+    const GstSegment *segment = gst_sample_get_segment(sample);
+    GstClock *clock = m_pipeline ? gst_element_get_clock(m_pipeline) : nullptr;
+    if (!segment || !clock) {
+        if (clock) {
+            gst_object_unref(clock);
+        }
+        return;
+    }
+
+    GstClockTime runningTime = gst_segment_to_running_time(segment, GST_FORMAT_TIME, pts);
+    GstClockTime now = gst_clock_get_time(clock);
+    gst_object_unref(clock);
+    if (!GST_CLOCK_TIME_IS_VALID(runningTime)) {
+        return;
+    }
+
+    GstClockTime arrival = gst_element_get_base_time(m_pipeline) + runningTime;
+    if (now >= arrival) {
+        qint64 sampled = frame.timing().at(FrameTiming::Sampled);
+        frame.stamp(FrameTiming::Source, sampled - static_cast<qint64>(now - arrival));
+    }
+}
+
+bool GStreamerRtsp::isNonReferenceUnit(GstBuffer *buffer, bool h265) {
+    GstMapInfo map;
+    if (!gst_buffer_map(buffer, &map, GST_MAP_READ)) {
+        return false;
+    }
+
+    // Find the first slice NAL of the byte-stream access unit
+    bool nonReference = false;
+    const guint8 *data = map.data;
+    gsize size = map.size;
+    for (gsize i = 0; i + 3 < size; ++i) {
+        if (data[i] != 0 || data[i + 1] != 0 || data[i + 2] != 1) {
+            continue;
+        }
+
+        guint8 header = data[i + 3];
+        if (h265) {
+            int type = (header >> 1) & 0x3F;
+            if (type < 32) {
+                // Sub-layer non-reference pictures have even types up to RSV_VCL_N14
+                nonReference = (type <= 14) && (type % 2 == 0);
+                break;
+            }
+        } else {
+            int type = header & 0x1F;
+            if (type == 1 || type == 5) {
+                nonReference = ((header >> 5) & 0x3) == 0;  // nal_ref_idc
+                break;
+            }
+        }
+        i += 2;
+    }
+
+    gst_buffer_unmap(buffer, &map);
+    return nonReference;
+}
+
 GstFlowReturn GStreamerRtsp::cb_new_sample(GstElement *sink, gpointer user_data) {
     GStreamerRtsp *self = static_cast<GStreamerRtsp*>(user_data);
     GstSample *sample = gst_app_sink_pull_sample(GST_APP_SINK(sink));
@@ -354,76 +732,80 @@ GstFlowReturn GStreamerRtsp::cb_new_sample(GstElement *sink, gpointer user_data)
         return GST_FLOW_ERROR;
     }
 
-    try {
-        // Only get parameters if they haven't been detected yet
-        if (!self->m_parametersDetected.load(std::memory_order_acquire)) {
-            GstCaps *caps = gst_sample_get_caps(sample);
-            if (caps) {
-                GstStructure *str = gst_caps_get_structure(caps, 0);
-
-                // Get dimensions
-                gint width, height;
-                if (gst_structure_get_int(str, "width", &width) &&
-                    gst_structure_get_int(str, "height", &height)) {
-                    self->m_width = width;
-                    self->m_height = height;
-                    qDebug() << "Video dimensions detected from sample:" << width << "x" << height;
-                }
+    self->processSample(sample, sink == self->m_detectionSink);
 
-                // Get framerate
-                gint fps_n, fps_d;
-                if (gst_structure_get_fraction(str, "framerate", &fps_n, &fps_d)) {
-                    self->m_fps = (fps_d != 0) ? (fps_n / fps_d) : 25;
-                    qDebug() << "Video framerate detected from sample:" << self->m_fps
-                             << "(fraction:" << fps_n << "/" << fps_d << ")";
-                }
+    // Release the sample
+    gst_sample_unref(sample);
 
-                // If we have all parameters, set the flag
-                if (self->m_width > 0 && self->m_height > 0 && self->m_fps > 0) {
-                    self->m_parametersDetected.store(true, std::memory_order_release);
-                    qDebug() << "All video parameters detected from sample";
-                }
-            }
-        }
+    return GST_FLOW_OK;
+}
 
+void GStreamerRtsp::processSample(GstSample *sample, bool detection) {
+    try {
         // Process the frame
-        self->handleFrame(sample);
+        handleFrame(sample, detection);
 
     } catch (const std::exception& e) {
         qCritical() << "Error processing sample:" << e.what();
     } catch (...) {
         qCritical() << "Unknown error processing sample";
     }
+}
 
-    // Release the sample
-    gst_sample_unref(sample);
+void GStreamerRtsp::startPullers() {
+    if (!m_pullMode || m_displayPuller) {
+        return;
+    }
 
-    return GST_FLOW_OK;
+    m_displayPuller.reset(new AppSinkPuller(m_videoSink, [this](GstSample *sample) {
+        processSample(sample, false);
+    }));
+    m_detectionPuller.reset(new AppSinkPuller(m_detectionSink, [this](GstSample *sample) {
+        processSample(sample, true);
+    }));
+    m_displayPuller->start();
+    m_detectionPuller->start();
 }
 
-void GStreamerRtsp::handleFrame(GstSample *sample) {
+void GStreamerRtsp::stopPullers() {
+    // Destruction stops and joins the threads
+    m_displayPuller.reset();
+    m_detectionPuller.reset();
+}
+
+void GStreamerRtsp::handleFrame(GstSample *sample, bool detection) {
 
-    QImage image = convertFrameToImage(sample);
-    if (image.isNull()) {
-        qDebug() << "Failed to convert frame to QImage";
+    VideoFrame frame = detection ? VideoFrame::fromSample(sample) : convertFrame(sample);
+    if (frame.isNull()) {
+        qDebug() << "Failed to convert sample to frame";
         return;
     }
 
-    try {
-        // Emit frame for display
-        emit sendVideoFrame(image);
-        // Update FPS counter
-        // m_frameCount++;
-        // auto now = std::chrono::steady_clock::now();
-        // auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - m_lastFpsUpdateTime).count();
-        // if (elapsed >= 1000) {
-        //     m_currentFps = static_cast<int>(m_frameCount * 1000.0 / elapsed);
-        //     m_frameCount = 0;
-        //     m_lastFpsUpdateTime = now;
-        // }
+    stampTiming(frame, sample);
 
-    } catch (const std::exception& e) {
-        qCritical() << "Unhandled exception in frame processing:" << e.what();
+    m_lastFrameMs.store(m_clock.elapsed(), std::memory_order_release);
+    if (!m_connected.exchange(true, std::memory_order_acq_rel)) {
+        // First frame of this connection; close out any outage being timed
+        qint64 outageStart = m_outageStartMs.exchange(-1, std::memory_order_acq_rel);
+        if (outageStart >= 0) {
+            m_lastRecoveryMs.store(m_clock.elapsed() - outageStart, std::memory_order_relaxed);
+            qDebug() << "Stream recovered after" << m_lastRecoveryMs.load() << "ms:" << getUrl();
+        }
+        m_consecutiveFailures.store(0, std::memory_order_release);
+        m_timeToFirstFrameMs.store(m_clock.elapsed() - m_startMs.load(std::memory_order_acquire),
+                                   std::memory_order_relaxed);
+        qDebug() << "First frame after" << m_timeToFirstFrameMs.load() << "ms:" << getUrl();
+        emit sendConnectionStatus(this, true);
+    }
+
+    // Small frames go to detection, full resolution to display. The rings
+    // only move the handle; consumers are woken when they asked for it.
+    if (detection) {
+        if (m_detectionRing->push(frame)) {
+            emit detectionFrameReady();
+        }
+    } else if (m_displayRing->push(frame)) {
+        emit displayFrameReady();
     }
 }
 
@@ -493,60 +875,62 @@ gboolean GStreamerRtsp::bus_call(GstBus *bus, GstMessage *msg, gpointer data) {
 
 void GStreamerRtsp::cleanup() {
 
-    // Clear frame queue
-    {
-        QMutexLocker locker(&m_queueMutex);
-        m_frameQueue.clear();
-    }
+    // Pullers hold the appsinks; they go before the pipeline
+    stopPullers();
+
+    // Frames of the old pipeline are stale
+    m_displayRing->clear();
+    m_detectionRing->clear();
 
     if (m_pipeline) {
         gst_element_set_state(m_pipeline, GST_STATE_NULL);
         gst_object_unref(m_pipeline);
         m_pipeline = nullptr;
     }
+
+    // Elements were owned by the pipeline
+    m_source = nullptr;
+    m_depay = nullptr;
+    m_parser = nullptr;
+    m_decoder = nullptr;
+    m_tee = nullptr;
+    m_converter = nullptr;
+    m_videoSink = nullptr;
+    m_detectionSink = nullptr;
 }
 
-QImage GStreamerRtsp::convertFrameToImage(GstSample *sample) {
+void GStreamerRtsp::removeDecodeChain() {
+    GstElement *chain[] = { m_depay, m_parser, m_decoder };
+    for (GstElement *element : chain) {
+        if (element) {
+            gst_element_set_state(element, GST_STATE_NULL);
+            gst_bin_remove(GST_BIN(m_pipeline), element);
+        }
+    }
+
+    m_depay = nullptr;
+    m_parser = nullptr;
+    m_decoder = nullptr;
+}
+
+VideoFrame GStreamerRtsp::convertFrame(GstSample *sample) {
 
     GstCaps *caps = gst_sample_get_caps(sample);
     if (!caps) {
         qDebug() << "No caps in sample";
-        return QImage();
+        return VideoFrame();
     }
 
     GstStructure *str = gst_caps_get_structure(caps, 0);
     if (!gst_structure_get_int(str, "width", &m_width) ||
         !gst_structure_get_int(str, "height", &m_height)) {
         qDebug() << "Failed to get dimensions from caps";
-        return QImage();
-    }
-
-    GstBuffer *buffer = gst_sample_get_buffer(sample);
-    if (!buffer) {
-        qDebug() << "No buffer in sample";
-        return QImage();
+        return VideoFrame();
     }
 
-    GstMapInfo map;
-    if (!gst_buffer_map(buffer, &map, GST_MAP_READ)) {
-        qDebug() << "Failed to map buffer";
-        return QImage();
-    }
-
-    // Create QImage and copy the data
-    QImage image(
-        map.data,
-        m_width,
-        m_height,
-        QImage::Format_BGR888
-        );
-
-    // Make a deep copy before unmapping the buffer
-    QImage copy = image.copy();
-
-    gst_buffer_unmap(buffer, &map);
-
-    return copy;
+    // Wrap the sample without copying; the frame keeps it referenced
+    // until every consumer has dropped it
+    return VideoFrame::fromSample(sample);
 }
 
 void GStreamerRtsp::stop() {
@@ -563,9 +947,55 @@ void GStreamerRtsp::stop() {
 
 void GStreamerRtsp::run() {
     qDebug() << "GStreamer starting:" << getUrl();
-    m_stop.store(false, std::memory_order_release);
     m_stopUser.store(false, std::memory_order_release);
-    startStreamer();
+    m_consecutiveFailures.store(0, std::memory_order_release);
+    m_outageStartMs.store(-1, std::memory_order_release);
+
+    // Reconnect supervisor. A loop rather than recursion keeps the stack
+    // flat however often the camera drops out.
+    while (!m_stopUser.load(std::memory_order_acquire)) {
+        m_stop.store(false, std::memory_order_release);
+        m_connected.store(false, std::memory_order_release);
+        startStreamer();
+
+        if (m_stopUser.load(std::memory_order_acquire)) {
+            break;
+        }
+
+        // Time the outage from its first failure until a frame arrives again
+        qint64 expected = -1;
+        m_outageStartMs.compare_exchange_strong(expected, m_clock.elapsed(), std::memory_order_acq_rel);
+        m_consecutiveFailures.fetch_add(1, std::memory_order_acq_rel);
+        m_reconnectCount.fetch_add(1, std::memory_order_relaxed);
+        emit sendConnectionStatus(this, false);
+
+        int delay = nextReconnectDelay();
+        qDebug() << "Reconnecting" << getUrl() << "in" << delay << "ms"
+                 << "(attempt" << m_consecutiveFailures.load() << ")";
+        waitForReconnect(delay);
+    }
+
+    cleanup();
+    m_isRunning.store(false, std::memory_order_release);
+}
+
+int GStreamerRtsp::nextReconnectDelay() const {
+    // Exponential backoff with jitter so many cameras behind one failed
+    // switch do not reconnect in lockstep
+    int failures = qMax(1, m_consecutiveFailures.load(std::memory_order_acquire));
+    qint64 delay = static_cast<qint64>(RECONNECT_INITIAL_DELAY_MS) << qMin(failures - 1, 16);
+    delay = qMin<qint64>(delay, RECONNECT_MAX_DELAY_MS);
+
+    double jitter = 1.0 + RECONNECT_JITTER * (2.0 * QRandomGenerator::global()->generateDouble() - 1.0);
+    return static_cast<int>(delay * jitter);
+}
+
+void GStreamerRtsp::waitForReconnect(int delayMs) {
+    QElapsedTimer timer;
+    timer.start();
+    while (!m_stopUser.load(std::memory_order_acquire) && timer.elapsed() < delayMs) {
+        QThread::msleep(static_cast<unsigned long>(qMin<qint64>(50, delayMs - timer.elapsed())));
+    }
 }
 
 QString GStreamerRtsp::modifyRtspUrl(const QString& inFilename) {
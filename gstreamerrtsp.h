@@ -3,16 +3,21 @@
 
 #include <QThread>
 #include <QMutex>
-#include <QWaitCondition>
-#include <QQueue>
 #include <QThreadPool>
 #include <QImage>
+#include <QSize>
 #include <QSharedPointer>
+#include <QElapsedTimer>
 #include <atomic>
+#include <memory>
 #include <gst/gst.h>
 #include <gst/gstpad.h>
 #include <gst/app/gstappsink.h>
 #include <opencv2/opencv.hpp>
+#include "videoframe.h"
+#include "framering.h"
+#include "appsinkpuller.h"
+#include "eventrecorder.h"
 
 #define STRINGIFY(x) #x
 #define EXPAND(x) STRINGIFY(x)
@@ -20,6 +25,26 @@
 class GStreamerRtsp : public QThread {
     Q_OBJECT
 public:
+    // How much of the compressed stream reaches the decoder
+    // Skipping happens before the decoder, upstream of the display/detection
+    // tee, so it thins the display as much as detection
+    enum DecodeLevel {
+        DecodeAll = 0,          // Every access unit
+        DecodeReferenceOnly,    // Drop non-reference frames before decoding; a no-op on
+                                // streams where every P-frame is a reference (most IP cameras)
+        DecodeKeyframesOnly     // Drop every delta unit before decoding: one displayed frame per GOP
+    };
+    Q_ENUM(DecodeLevel)
+
+    // Reconnect supervisor tuning
+    static constexpr int RECONNECT_INITIAL_DELAY_MS = 250;
+    static constexpr int RECONNECT_MAX_DELAY_MS = 8000;
+    static constexpr double RECONNECT_JITTER = 0.2;     // +/- fraction of each delay
+    static constexpr int REBUILD_AFTER_FAILURES = 3;    // Reuse attempts before a full rebuild
+    static constexpr int STALL_TIMEOUT_MS = 5000;       // No frame for this long is a failure
+    static constexpr int FIRST_FRAME_TIMEOUT_MS = 10000; // Same, while still connecting
+    static constexpr int DEFAULT_RING_CAPACITY = 2;     // Frames queued per branch
+
     explicit GStreamerRtsp(QObject *parent = nullptr);
     ~GStreamerRtsp() override;
 
@@ -33,13 +58,51 @@ public:
     QString clientIP() const;
     QString serverIP() const;
 
+    // Branch settings, applied when the pipeline is built
+    void setDisplayMaxFps(int fps);   // 0 keeps the camera rate
+
+    // Frame rings between the appsinks and their consumers. Configure before
+    // start(); each ring has one consumer thread.
+    void setDisplayRing(int capacity, FrameRing::DropPolicy policy);
+    void setDetectionRing(int capacity, FrameRing::DropPolicy policy);
+    FrameRing *displayRing() const;
+    FrameRing *detectionRing() const;
+
+    // Drain the appsinks from dedicated threads instead of new-sample
+    // callbacks on the streaming threads. Set before start().
+    void setPullMode(bool enabled);
+    bool pullMode() const;
+
+    // Passthrough clip recording. An empty directory disables it; the
+    // container is "mp4", "mkv" or "avi". Set after setUrl() and before
+    // start().
+    void setRecording(const QString &outputDir, const QString &container = QString());
+    void triggerRecording();     // Any thread; starts or extends a clip
+    int recordedClips() const;
+
+    // Frames skipped here never reach the display either: at
+    // DecodeKeyframesOnly the picture updates once per GOP
+    void setDecodeLevel(DecodeLevel level);
+    DecodeLevel decodeLevel() const;
+    quint64 decoderSkippedFrames() const;   // Stays 0 while the level finds nothing to drop
+
+    int reconnectCount() const;
+    qint64 lastRecoveryMs() const;   // Outage start to first frame, -1 before any reconnect
+    qint64 timeToFirstFrameMs() const;   // Last (re)start to its first frame, -1 before any
+
+    static void initializeGStreamer();
+
 public slots:
     void stop();
     void startStreamer();
 
 signals:
-    void sendVideoFrame(const QImage &frame);
+    // A ring got a frame after its consumer asked to be woken. Emitted on
+    // the streaming thread, at most once per request.
+    void displayFrameReady();       // Full resolution, display branch
+    void detectionFrameReady();     // Detection size, detection branch
     void sendConnectionStatus(GStreamerRtsp* rtsp, bool status);
+    void streamReady(int width, int height, int fps);
 
 protected:
     void run() override;
@@ -47,24 +110,46 @@ protected:
 private:
     bool initialize();
     void cleanup();
+    void removeDecodeChain();
     void printParameters();
 
+    int nextReconnectDelay() const;
+    void waitForReconnect(int delayMs);
+
     QString modifyRtspUrl(const QString& inFilename);
-    QImage convertFrameToImage(GstSample *sample);
-    void handleFrame(GstSample *sample);
+    VideoFrame convertFrame(GstSample *sample);
+    void handleFrame(GstSample *sample, bool detection);
+    void processSample(GstSample *sample, bool detection);
+    void startPullers();
+    void stopPullers();
+    void stampTiming(const VideoFrame &frame, GstSample *sample);
 
     static GstFlowReturn cb_new_sample(GstElement *sink, gpointer user_data);
     static gboolean bus_call(GstBus *bus, GstMessage *msg, gpointer data);
     static void on_pad_added(GstElement *element, GstPad *pad, gpointer data);
+    static void on_caps_notify(GstPad *pad, GParamSpec *pspec, gpointer data);
+    static GstPadProbeReturn decoder_probe(GstPad *pad, GstPadProbeInfo *info, gpointer data);
+    static GstPadProbeReturn decoded_probe(GstPad *pad, GstPadProbeInfo *info, gpointer data);
+    static GstPadProbeReturn parser_probe(GstPad *pad, GstPadProbeInfo *info, gpointer data);
+    static bool isNonReferenceUnit(GstBuffer *buffer, bool h265);
 
     GstElement *m_pipeline = nullptr;
     GstElement *m_source = nullptr;
     GstElement *m_depay = nullptr;
+    GstElement *m_parser = nullptr;
     GstElement *m_decoder = nullptr;
     GstElement *m_converter = nullptr;
     GstElement *m_videoSink = nullptr;
+    GstElement *m_detectionSink = nullptr;
     GstElement *m_tee = nullptr;
 
+    int m_displayMaxFps = 0;
+    bool m_pullMode = false;
+    std::unique_ptr<AppSinkPuller> m_displayPuller;
+    std::unique_ptr<AppSinkPuller> m_detectionPuller;
+    QString m_recordDir;
+    std::unique_ptr<EventRecorder> m_recorder;
+
     QString m_inFilename;
     QString m_name;
     QString m_info;
@@ -77,6 +162,31 @@ private:
     std::atomic<bool> m_stop{false};
     std::atomic<bool> m_stopUser{false};  
 
+    std::atomic<int> m_decodeLevel{DecodeAll};
+    std::atomic<bool> m_waitForKeyframe{false};
+    std::atomic<quint64> m_decoderSkipped{0};
+    bool m_isH265 = false;
+
+    // Recent decoder output times by PTS, looked up again at the appsinks
+    static constexpr int DECODE_TIME_SLOTS = 16;
+    struct DecodeTime {
+        GstClockTime pts = GST_CLOCK_TIME_NONE;
+        qint64 ns = 0;
+    };
+    DecodeTime m_decodeTimes[DECODE_TIME_SLOTS];
+    int m_decodeTimeNext = 0;
+    QMutex m_decodeTimesMutex;
+
+    QElapsedTimer m_clock;
+    std::atomic<int> m_consecutiveFailures{0};
+    std::atomic<int> m_reconnectCount{0};
+    std::atomic<qint64> m_lastRecoveryMs{-1};
+    std::atomic<qint64> m_outageStartMs{-1};   // -1 while connected
+    std::atomic<qint64> m_lastFrameMs{0};
+    std::atomic<bool> m_connected{false};
+    std::atomic<qint64> m_startMs{0};
+    std::atomic<qint64> m_timeToFirstFrameMs{-1};
+
     std::chrono::steady_clock::time_point m_lastFpsUpdateTime;
     int m_frameCount = 0;
     int m_currentFps = 0;
@@ -87,9 +197,8 @@ private:
     QMutex m_mutex;  
     std::atomic<bool> m_parametersDetected{false};
 
-    QQueue<cv::Mat> m_frameQueue;
-    QMutex m_queueMutex;
-    QWaitCondition m_queueCondition;
+    std::unique_ptr<FrameRing> m_displayRing;
+    std::unique_ptr<FrameRing> m_detectionRing;
 };
 
 #endif // GSTREAMERTSP_H
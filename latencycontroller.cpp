@@ -0,0 +1,95 @@
+#include "latencycontroller.h"
+#include <cmath>
+#include "detectionworker.h"
+
+void LatencyController::setBudget(double ms) {
+    m_budgetMs = qMax(0.0, ms);
+    m_samplesSinceChange = 0;
+    update();
+}
+
+std::vector<cv::Size> LatencyController::presetSizes(const ModelInfo &model) {
+    std::vector<cv::Size> sizes;
+    if (model.resizable() && model.inputSize.width > 0) {
+        const int step = DetectionWorker::INPUT_GRANULARITY;
+        for (int width : PRESETS) {
+            int height = qMax(step, qRound(static_cast<double>(width) * model.inputSize.height / model.inputSize.width / step) * step);
+            sizes.emplace_back(width, height);
+        }
+    } else {
+        sizes.push_back(model.inputSize);
+    }
+    return sizes;
+}
+
+void LatencyController::setModel(const ModelInfo &model) {
+    m_resizable = model.resizable() && model.inputSize.width > 0;
+    m_sizes = presetSizes(model);
+    m_averageMs.assign(m_sizes.size(), 0.0);
+    m_lastSample.assign(m_sizes.size(), 0);
+
+    // Start at the largest preset that is not above the trained size
+    m_preset = 0;
+    for (size_t i = 0; i < m_sizes.size(); ++i) {
+        if (m_sizes[i].width <= model.inputSize.width) {
+            m_preset = static_cast<int>(i);
+        }
+    }
+    m_samplesSinceChange = 0;
+    update();
+}
+
+bool LatencyController::shouldDetect() {
+    bool detect = m_frame == 0;
+    m_frame = (m_frame + 1) % m_stride;
+    return detect;
+}
+
+cv::Size LatencyController::inputSize() const {
+    return m_budgetMs > 0.0 && m_resizable ? m_sizes[m_preset] : cv::Size();
+}
+
+void LatencyController::addSample(const cv::Size &inputSize, double ms) {
+    for (size_t i = 0; i < m_sizes.size(); ++i) {
+        if (m_sizes[i] != inputSize) {
+            continue;
+        }
+        double &average = m_averageMs[i];
+        average = average > 0.0 ? average + SMOOTHING * (ms - average) : ms;
+        m_lastSample[i] = ++m_samples;
+        m_samplesSinceChange++;
+        update();
+        return;
+    }
+}
+
+double LatencyController::expectedMs(int preset) const {
+    // A recent measurement, otherwise scale the current size's by area
+    if (m_averageMs[preset] > 0.0 && m_samples - m_lastSample[preset] < STALE_SAMPLES) {
+        return m_averageMs[preset];
+    }
+    double current = m_averageMs[m_preset];
+    return current * m_sizes[preset].area() / qMax(1, m_sizes[m_preset].area());
+}
+
+void LatencyController::update() {
+    if (m_budgetMs <= 0.0 || m_sizes.empty()) {
+        m_stride = DEFAULT_STRIDE;
+        return;
+    }
+
+    // One preset step at a time, never before the last change has settled
+    if (m_resizable && m_samplesSinceChange >= HOLD_SAMPLES) {
+        if (m_preset > 0 && expectedMs(m_preset) > m_budgetMs) {
+            m_preset--;
+            m_samplesSinceChange = 0;
+        } else if (m_preset + 1 < static_cast<int>(m_sizes.size())
+                   && expectedMs(m_preset + 1) <= m_budgetMs * UPSCALE_HEADROOM) {
+            m_preset++;
+            m_samplesSinceChange = 0;
+        }
+    }
+
+    double expected = expectedMs(m_preset);
+    m_stride = expected > 0.0 ? qBound(1, static_cast<int>(std::ceil(expected / m_budgetMs)), MAX_STRIDE) : 1;
+}
@@ -0,0 +1,60 @@
+#ifndef LATENCYCONTROLLER_H
+#define LATENCYCONTROLLER_H
+
+#include <QtGlobal>
+#include <opencv2/core.hpp>
+#include <vector>
+#include "modelregistry.h"
+
+// Picks a stream's network input size and detection rate from measured
+// forward-pass times. The largest preset size whose expected time fits the
+// budget is used; when even the smallest one does not fit, frames are
+// detected less often so the stream's average inference cost still does.
+// Without a budget the model's own size runs on every DEFAULT_STRIDE'th frame.
+class LatencyController
+{
+public:
+    static constexpr int PRESETS[] = { 320, 416, 608 };   // Input widths, smallest first
+    static constexpr int DEFAULT_STRIDE = 2;          // Detect every 2nd frame
+    static constexpr int MAX_STRIDE = 8;
+    static constexpr double SMOOTHING = 0.2;          // Weight of a new sample in the average
+    static constexpr double UPSCALE_HEADROOM = 0.8;   // A larger size must fit this share of the budget
+    static constexpr int HOLD_SAMPLES = 10;           // Between size changes, so each settles
+    static constexpr int STALE_SAMPLES = 300;         // Older measurements are re-estimated
+
+    // Milliseconds a detection pass may take; 0 disables the controller
+    void setBudget(double ms);
+    double budget() const { return m_budgetMs; }
+
+    // Presets follow the model's aspect ratio; models with a fixed input
+    // only get their detection rate adjusted
+    void setModel(const ModelInfo &model);
+    static std::vector<cv::Size> presetSizes(const ModelInfo &model);   // Smallest first
+
+    // Advances the frame count; false for frames to skip
+    bool shouldDetect();
+
+    // Empty while the model's own size applies
+    cv::Size inputSize() const;
+    int stride() const { return m_stride; }
+
+    // A finished inference; samples at non-preset sizes (crops) are ignored
+    void addSample(const cv::Size &inputSize, double ms);
+
+private:
+    double expectedMs(int preset) const;
+    void update();
+
+    double m_budgetMs = 0.0;
+    bool m_resizable = false;
+    std::vector<cv::Size> m_sizes;      // Candidate inputs, smallest first
+    std::vector<double> m_averageMs;    // Per size, 0 until measured
+    std::vector<quint64> m_lastSample;  // m_samples when each size was last measured
+    quint64 m_samples = 0;
+    int m_preset = 0;
+    int m_stride = DEFAULT_STRIDE;
+    int m_frame = 0;
+    int m_samplesSinceChange = 0;
+};
+
+#endif // LATENCYCONTROLLER_H
@@ -0,0 +1,106 @@
+#include "latencystats.h"
+#include <QStringList>
+#include <algorithm>
+
+LatencyStats::LatencyStats(int window)
+    : m_window(qMax(1, window)) {
+    m_samples.reserve(m_window);
+}
+
+void LatencyStats::add(const FrameTiming &timing) {
+    if (static_cast<int>(m_samples.size()) < m_window) {
+        m_samples.push_back(timing);
+    } else {
+        m_samples[m_next] = timing;
+    }
+    m_next = (m_next + 1) % m_window;
+}
+
+void LatencyStats::clear() {
+    m_samples.clear();
+    m_next = 0;
+}
+
+int LatencyStats::size() const {
+    return static_cast<int>(m_samples.size());
+}
+
+LatencyStats::Percentiles LatencyStats::compute(std::vector<double> &values) {
+    Percentiles result;
+    if (values.empty()) {
+        return result;
+    }
+
+    std::sort(values.begin(), values.end());
+    auto at = [&values](double p) {
+        size_t index = static_cast<size_t>(p * (values.size() - 1) + 0.5);
+        return values[std::min(index, values.size() - 1)];
+    };
+
+    result.count = static_cast<int>(values.size());
+    result.p50 = at(0.50);
+    result.p90 = at(0.90);
+    result.p99 = at(0.99);
+    result.max = values.back();
+    return result;
+}
+
+LatencyStats::Percentiles LatencyStats::percentiles(FrameTiming::Stage from, FrameTiming::Stage to) const {
+    std::vector<double> values;
+    values.reserve(m_samples.size());
+    for (const FrameTiming &timing : m_samples) {
+        double ms = timing.spanMs(from, to);
+        if (ms >= 0.0) {
+            values.push_back(ms);
+        }
+    }
+    return compute(values);
+}
+
+LatencyStats::Percentiles LatencyStats::endToEnd(FrameTiming::Stage to) const {
+    std::vector<double> values;
+    values.reserve(m_samples.size());
+    for (const FrameTiming &timing : m_samples) {
+        FrameTiming::Stage first = timing.firstStage();
+        if (first >= to) {
+            continue;
+        }
+        double ms = timing.spanMs(first, to);
+        if (ms >= 0.0) {
+            values.push_back(ms);
+        }
+    }
+    return compute(values);
+}
+
+QString LatencyStats::summary(FrameTiming::Stage to) const {
+    Percentiles total = endToEnd(to);
+    if (total.count == 0) {
+        return QString();
+    }
+
+    QStringList parts;
+    parts << QString("e2e %1/%2/%3 ms")
+                 .arg(total.p50, 0, 'f', 0)
+                 .arg(total.p90, 0, 'f', 0)
+                 .arg(total.p99, 0, 'f', 0);
+
+    // p50 of each hop between measured stages, labelled by where it ends
+    int from = -1;
+    for (int s = FrameTiming::Source; s <= to; ++s) {
+        bool measured = std::any_of(m_samples.begin(), m_samples.end(),
+                                    [s](const FrameTiming &timing) { return timing.stamps[s] > 0; });
+        if (!measured) {
+            continue;
+        }
+        if (from >= 0) {
+            FrameTiming::Stage stage = static_cast<FrameTiming::Stage>(s);
+            Percentiles hop = percentiles(static_cast<FrameTiming::Stage>(from), stage);
+            if (hop.count > 0) {
+                parts << QString("%1 %2").arg(FrameTiming::stageName(stage)).arg(hop.p50, 0, 'f', 1);
+            }
+        }
+        from = s;
+    }
+    return parts.join(" | ");
+}
@@ -0,0 +1,43 @@
+#ifndef LATENCYSTATS_H
+#define LATENCYSTATS_H
+
+#include <QString>
+#include <vector>
+#include "frametiming.h"
+
+// Sliding window of recent FrameTimings with percentile readouts, end to end
+// and per stage. Not thread-safe; feed and read it from one thread.
+class LatencyStats
+{
+public:
+    static constexpr int DEFAULT_WINDOW = 512;
+
+    struct Percentiles {
+        int count = 0;
+        double p50 = 0.0;
+        double p90 = 0.0;
+        double p99 = 0.0;
+        double max = 0.0;
+    };
+
+    explicit LatencyStats(int window = DEFAULT_WINDOW);
+
+    void add(const FrameTiming &timing);
+    void clear();
+    int size() const;
+
+    Percentiles percentiles(FrameTiming::Stage from, FrameTiming::Stage to) const;
+    Percentiles endToEnd(FrameTiming::Stage to) const;   // From each frame's first stage
+
+    // "e2e p50/p90/p99" followed by the p50 of every hop that has samples
+    QString summary(FrameTiming::Stage to) const;
+
+private:
+    static Percentiles compute(std::vector<double> &values);
+
+    std::vector<FrameTiming> m_samples;
+    int m_window;
+    int m_next = 0;
+};
+
+#endif // LATENCYSTATS_H
@@ -9,6 +9,11 @@ int main(int argc, char *argv[])
 {
     QApplication a(argc, argv);
 
+    qRegisterMetaType<VideoFrame>("VideoFrame");
+    qRegisterMetaType<DetectionResult>("DetectionResult");
+    qRegisterMetaType<DetectionRequest>("DetectionRequest");
+    qRegisterMetaType<QVector<DetectionRequest>>("QVector<DetectionRequest>");
+
     a.setStyle(QStyleFactory::create("Fusion"));
 
     // Set up a dark color scheme with yellow accents
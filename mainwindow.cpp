@@ -1,12 +1,15 @@
 #include "mainwindow.h"
 #include <QScreen>
+#include <QStatusBar>
 #include "ui_mainwindow.h"
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
     , ui(new Ui::MainWindow)
-    , workerDetection(nullptr)
-    , workerDetectionThread(nullptr)
+    , streamManager(nullptr)
+    , rtspStreamId(-1)
+    , fileStreamId(-1)
+    , displayStreamId(-1)
     , videoReader(nullptr)
     , videoThread(nullptr)
 {
@@ -20,12 +23,7 @@ MainWindow::MainWindow(QWidget *parent)
     ui->imageLabel->setMaximumHeight(1080);
     this->resize(1280, 720);
 
-    // Initialize RTSP stream
-    rtspStream = QSharedPointer<GStreamerRtsp>::create(this);
-    connect(rtspStream.data(), &GStreamerRtsp::sendVideoFrame,
-            this, &MainWindow::setVideoFrame);
-
-    // Initialize worker and thread
+    // Initialize stream manager, worker pool and file reader
     initializeWorker();
 
     QScreen* screen = QGuiApplication::primaryScreen();
@@ -43,25 +41,30 @@ MainWindow::~MainWindow()
 
 void MainWindow::initializeWorker()
 {
-    // Create worker and thread
-    workerDetection = new DetectionWorker();
-    workerDetectionThread = new QThread(this);
-    workerDetection->moveToThread(workerDetectionThread);
-
-    // Connect signals/slots
-    connect(workerDetection, &DetectionWorker::detectionDone,
+    // RTSP streams and the file reader share one pool of detection workers,
+    // sized to the machine. Any stream may use all of them at once.
+    streamManager = new StreamManager(StreamManager::defaultWorkerCount(), this);
+    streamManager->setMaxInFlight(streamManager->workerCount());
+
+    connect(streamManager, &StreamManager::displayFrameReady,
+            this, &MainWindow::handleDisplayFrameReady);
+    connect(streamManager, &StreamManager::detectionDone,
             this, &MainWindow::handleDetectionResult);
-    connect(workerDetectionThread, &QThread::finished,
-            workerDetection, &QObject::deleteLater);
+    connect(streamManager, &StreamManager::statsUpdated,
+            this, &MainWindow::handleStreamStats);
 
-    // Start the thread
-    workerDetectionThread->start();
+    fileStreamId = streamManager->addExternalStream("file");
 
     videoThread = new QThread(this);
     videoReader = new VideoReader();
     videoReader->moveToThread(videoThread);
 
-    connect(videoReader, &VideoReader::frameReady, this, &MainWindow::setVideoFrame);
+    // Straight into the stream's mailboxes on the reader thread; a frame the
+    // workers or the display did not get to in time is replaced, never queued
+    connect(videoReader, &VideoReader::frameReady, streamManager,
+            [this](const VideoFrame &frame) {
+                streamManager->submitFrame(fileStreamId, frame);
+            }, Qt::DirectConnection);
     connect(videoReader, &VideoReader::finished, this, &MainWindow::handleVideoFinished);
     connect(videoThread, &QThread::finished, videoReader, &QObject::deleteLater);
 
@@ -70,18 +73,15 @@ void MainWindow::initializeWorker()
 
 void MainWindow::cleanupWorker()
 {
-    if (workerDetectionThread) {
-        workerDetectionThread->quit();
-        workerDetectionThread->wait();
-        delete workerDetection;
-        workerDetection = nullptr;
-        workerDetectionThread = nullptr;
-    }
-
     if (videoThread) {
+        videoReader->stopReading();
         videoThread->quit();
         videoThread->wait();
     }
+
+    // Stops all streams and joins the worker threads
+    delete streamManager;
+    streamManager = nullptr;
 }
 
 void MainWindow::openFile()
@@ -94,31 +94,138 @@ void MainWindow::openFile()
 
     if (!fileName.isEmpty() && videoReader) {
         ui->lineUrl->setText(fileName);
+        displayStreamId = fileStreamId;
         QMetaObject::invokeMethod(videoReader, "startReading", Qt::QueuedConnection, Q_ARG(QString, fileName));
     }
 }
 
-void MainWindow::setVideoFrame(const QImage &frame)
+void MainWindow::handleDisplayFrameReady(int streamId)
+{
+    // Always drain so the ring keeps waking us; only the newest frame is shown
+    VideoFrame frame;
+    if (streamManager->takeDisplayFrame(streamId, frame)) {
+        handleDisplayFrame(streamId, frame);
+    }
+}
+
+void MainWindow::handleDisplayFrame(int streamId, const VideoFrame &frame)
 {
-    QImage resizedFrame = frame.scaled(1280, 720, Qt::KeepAspectRatio, Qt::SmoothTransformation);
-    if (resizedFrame.isNull() || resizedFrame.width() == 0 || resizedFrame.height() == 0) {
-        qDebug() << "Resized frame is invalid!";
+    if (streamId != displayStreamId || frame.isNull()) {
         return;
     }
 
-    if (shouldDetectObject()) {
-        // Use QMetaObject::invokeMethod to safely call across threads
-        QMetaObject::invokeMethod(workerDetection, "detectObject",
-                                  Qt::QueuedConnection,
-                                  Q_ARG(QImage, resizedFrame));
+    // Uploading to a pixmap is the one conversion display needs; the
+    // latest detections are painted on it at full resolution
+    QPixmap pixmap = QPixmap::fromImage(frame.image());
+    auto it = lastResults.find(streamId);
+    if (it != lastResults.end()) {
+        QPainter painter(&pixmap);
+        drawDetections(painter, pixmap.size(), *it);
+        drawPerformanceInfo(painter, pixmap.size(), *it, frame);
     }
-}
 
-void MainWindow::handleDetectionResult(const QImage &result)
-{
-    QPixmap pixmap = QPixmap::fromImage(result);
     ui->imageLabel->setPixmap(pixmap);
     ui->imageLabel->setScaledContents(true);
+
+    qint64 now = VideoFrame::nowNs();
+    frame.stamp(FrameTiming::Displayed, now);
+    videoLatency[streamId].add(frame.timing());
+
+    // A result counts once, when its boxes first reach the screen
+    if (it != lastResults.end() && it->timing.at(FrameTiming::Displayed) == 0) {
+        it->timing.stamps[FrameTiming::Displayed] = now;
+        detectionLatency[streamId].add(it->timing);
+    }
+}
+
+void MainWindow::handleDetectionResult(int streamId, const DetectionResult &result)
+{
+    // Frames without inference carry the tracker's predictions (or the
+    // previous boxes); timing and latency stay with the last detection
+    if (result.detected) {
+        DetectionResult &last = lastResults[streamId];
+        last = result;
+        last.timing.stamps[FrameTiming::Delivered] = VideoFrame::nowNs();
+    } else if (result.reused) {
+        auto it = lastResults.find(streamId);
+        if (it != lastResults.end()) {
+            it->detections = result.detections;
+        }
+    }
+}
+
+void MainWindow::drawDetections(QPainter &painter, const QSize &size, const DetectionResult &result)
+{
+    static const QColor colors[] = {
+        QColor(0, 0, 255),    // Blue
+        QColor(0, 255, 0),    // Green
+        QColor(255, 0, 0),    // Red
+        QColor(0, 255, 255),  // Cyan
+        QColor(255, 0, 255)   // Magenta
+    };
+
+    QFontMetrics metrics(painter.font());
+
+    for (const Detection &detection : result.detections) {
+        if (detection.label.empty()) {
+            continue;
+        }
+
+        QColor color = colors[detection.classId % 5];
+        QRectF box(detection.box.x * size.width(), detection.box.y * size.height(),
+                   detection.box.width * size.width(), detection.box.height * size.height());
+
+        // Draw box
+        painter.setPen(QPen(color, 2));
+        painter.setBrush(Qt::NoBrush);
+        painter.drawRect(box);
+
+        // Calculate distance (simplified)
+        float distanceToObject = (DetectionWorker::KNOWN_WIDTH * DetectionWorker::FOCAL_LENGTH) / box.width();
+
+        // Create label
+        QString name = QString::fromStdString(detection.label);
+        if (detection.trackId >= 0) {
+            name += QString(" #%1").arg(detection.trackId);
+        }
+        QString label = QString("%1: %2% dist: %3m")
+                            .arg(name)
+                            .arg(static_cast<int>(detection.confidence * 100))
+                            .arg(distanceToObject, 0, 'f', 2);
+
+        // Draw label with background
+        QRectF labelRect(box.x(), qMax(0.0, box.y() - metrics.height() - 4),
+                         metrics.horizontalAdvance(label) + 6, metrics.height() + 4);
+        painter.fillRect(labelRect, color);
+        painter.setPen(Qt::white);
+        painter.drawText(labelRect, Qt::AlignCenter, label);
+    }
+}
+
+void MainWindow::drawPerformanceInfo(QPainter &painter, const QSize &size, const DetectionResult &result,
+                                     const VideoFrame &frame)
+{
+    QStringList lines = {
+        QString("FPS: %1").arg(static_cast<int>(result.fps)),
+        QString("Time: %1s").arg(result.processingTime, 0, 'f', 3),
+        QString("Size: %1x%2").arg(size.width()).arg(size.height()),
+        QString("Copied: %1KB").arg(frame.bytesCopied() / 1024)
+    };
+    if (!latencyOverlay.isEmpty()) {
+        lines << latencyOverlay;
+    }
+
+    QFontMetrics metrics(painter.font());
+    int lineHeight = metrics.height() + 4;
+
+    // Draw background
+    painter.fillRect(QRect(10, 10, 220, lineHeight * lines.size() + 8), Qt::black);
+
+    // Draw text
+    painter.setPen(QColor(255, 255, 0));
+    for (int i = 0; i < lines.size(); ++i) {
+        painter.drawText(QPoint(15, 10 + lineHeight * (i + 1)), lines[i]);
+    }
 }
 
 void MainWindow::handleVideoFinished() {
@@ -134,45 +241,71 @@ void MainWindow::updateImageLabel(const QImage &processedImage)
     ui->imageLabel->setScaledContents(true);
 }
 
-void MainWindow::handleError(const QString &errorMessage)
+void MainWindow::handleStreamStats(const QList<StreamStats> &stats)
 {
-    qDebug() << "Error:" << errorMessage;
-    QMessageBox::critical(this, tr("Error"), errorMessage);
-}
-
-bool MainWindow::shouldDetectObject()
-{
-    static int frameCounter = 0;
-    static int processedFrames = 0;
-    static bool recentDetection = false;
-
-    frameCounter++;
-
-    // Eğer yakın zamanda tespit varsa daha az sıklıkta işle (anti-flicker)
-    int skipRate = recentDetection ? 4 : 2; // Tespit varsa 4'te 1, yoksa 2'de 1
-
-    if (frameCounter % skipRate == 0 && processedFrames < 12) {
-        processedFrames++;
+    for (const StreamStats &stream : stats) {
+        if (stream.streamId != displayStreamId) {
+            continue;
+        }
 
-        // 12 frame işledikten sonra sayacı sıfırla
-        if (processedFrames == 12) {
-            frameCounter = 0;
-            processedFrames = 0;
-            // Recent detection flag'ini sıfırla
-            recentDetection = false;
+        static const char *decodeLevels[] = { "all", "reference", "keyframes" };
+        QString message = QString("Stream %1 | Input: %2 fps | Detection: %3 fps | Skipped: %4 (%5 superseded, display %6) | Decode: %7 (%8 skipped)")
+                              .arg(stream.streamId)
+                              .arg(stream.inputFps, 0, 'f', 1)
+                              .arg(stream.detectionFps, 0, 'f', 1)
+                              .arg(stream.framesSkipped)
+                              .arg(stream.framesDropped)
+                              .arg(stream.displayDropped)
+                              .arg(decodeLevels[qBound(0, stream.decodeLevel, 2)])
+                              .arg(stream.decoderSkipped);
+        if (stream.framesGateEvaluated > 0) {
+            message += QString(" | Motion saved: %1%").arg(stream.inferenceSaved * 100.0, 0, 'f', 0);
+        }
+        if (stream.avgBatchSize > 0.0) {
+            message += QString(" | Inference: %1 ms/frame (batch %2)")
+                           .arg(stream.inferenceMs, 0, 'f', 1)
+                           .arg(stream.avgBatchSize, 0, 'f', 1);
+        }
+        if (stream.inputSize.area() > 0) {
+            message += QString(" | Input: %1x%2, 1/%3 frames")
+                           .arg(stream.inputSize.width).arg(stream.inputSize.height).arg(stream.detectStride);
+        }
+        if (stream.timeToFirstFrameMs >= 0) {
+            message += QString(" | First frame: %1 ms").arg(stream.timeToFirstFrameMs);
+        }
+        if (stream.timeToFirstDetectionMs >= 0) {
+            message += QString(" | First detection: %1 ms (model ready after %2 ms)")
+                           .arg(stream.timeToFirstDetectionMs)
+                           .arg(streamManager->modelReadyMs());
+        }
+        if (stream.reconnectCount > 0) {
+            message += QString(" | Reconnects: %1 (last recovery %2 ms)")
+                           .arg(stream.reconnectCount)
+                           .arg(stream.lastRecoveryMs);
         }
 
-        return true;
-    }
+        // Live glass-to-glass readout, p50/p90/p99 and the p50 of each stage
+        QString video = videoLatency.value(stream.streamId).summary(FrameTiming::Displayed);
+        QString detection = detectionLatency.value(stream.streamId).summary(FrameTiming::Displayed);
+        if (!video.isEmpty()) {
+            message += QString(" | Video %1").arg(video);
+        }
+        if (!detection.isEmpty()) {
+            message += QString(" | Boxes %1").arg(detection);
+        }
 
-    // 24 frame tamamlandığında sayacları sıfırla
-    if (frameCounter >= 24) {
-        frameCounter = 0;
-        processedFrames = 0;
-        recentDetection = false;
+        LatencyStats::Percentiles boxes = detectionLatency.value(stream.streamId).endToEnd(FrameTiming::Displayed);
+        latencyOverlay = boxes.count > 0
+                             ? QString("Latency: %1/%2ms p50/p99").arg(boxes.p50, 0, 'f', 0).arg(boxes.p99, 0, 'f', 0)
+                             : QString();
+        statusBar()->showMessage(message);
     }
+}
 
-    return false;
+void MainWindow::handleError(const QString &errorMessage)
+{
+    qDebug() << "Error:" << errorMessage;
+    QMessageBox::critical(this, tr("Error"), errorMessage);
 }
 
 void MainWindow::on_playButton_clicked()
@@ -180,20 +313,20 @@ void MainWindow::on_playButton_clicked()
     auto cameraUrl = ui->lineUrl->text();
 
     if (ui->playButton->text() == "Play") {
-        if (rtspStream && !rtspStream->isRunning()) {
-            rtspStream->setUrl(cameraUrl);
-            rtspStream->start();
+        if (rtspStreamId == -1) {
+            rtspStreamId = streamManager->addStream(cameraUrl);
+            displayStreamId = rtspStreamId;
         } else {
-            qWarning() << "RTSP stream object is null for camera:" << cameraUrl;
+            qWarning() << "RTSP stream already running for camera:" << cameraUrl;
         }
         ui->playButton->setText("Stop");
     } else {
-        if (rtspStream && rtspStream->isRunning()) {
-            rtspStream->stop();
-            if (!rtspStream->wait(1000)) {
-                rtspStream->terminate();
-                rtspStream->wait();
-            }
+        if (rtspStreamId != -1) {
+            streamManager->removeStream(rtspStreamId);
+            lastResults.remove(rtspStreamId);
+            videoLatency.remove(rtspStreamId);
+            detectionLatency.remove(rtspStreamId);
+            rtspStreamId = -1;
         }
         ui->playButton->setText("Play");
     }
@@ -6,9 +6,11 @@
 #include <QFileDialog>
 #include <QMessageBox>
 #include <QThread>
-#include "gstreamerrtsp.h"
-#include "detectionworker.h"
+#include <QHash>
+#include <QPainter>
+#include "streammanager.h"
 #include "videoreader.h"
+#include "latencystats.h"
 
 #define STRINGIFY(x) #x
 #define EXPAND(x) STRINGIFY(x)
@@ -29,24 +31,33 @@ public:
 
 private slots:
     void openFile();
-    void setVideoFrame(const QImage &frame);
     void updateImageLabel(const QImage &processedImage);
     void handleError(const QString &errorMessage);
-    void handleDetectionResult(const QImage &result);
+    void handleDisplayFrameReady(int streamId);
+    void handleDisplayFrame(int streamId, const VideoFrame &frame);
+    void handleDetectionResult(int streamId, const DetectionResult &result);
+    void handleStreamStats(const QList<StreamStats> &stats);
     void handleVideoFinished();
     void on_playButton_clicked();    
     void on_openButton_clicked();
 
 private:
-    bool shouldDetectObject();
     void initializeWorker();
     void cleanupWorker();
+    void drawDetections(QPainter &painter, const QSize &size, const DetectionResult &result);
+    void drawPerformanceInfo(QPainter &painter, const QSize &size, const DetectionResult &result,
+                             const VideoFrame &frame);
 
 private:
     Ui::MainWindow *ui;
-    QSharedPointer<GStreamerRtsp> rtspStream;
-    DetectionWorker *workerDetection;
-    QThread *workerDetectionThread;
+    StreamManager *streamManager;
+    int rtspStreamId;       // -1 while not playing
+    int fileStreamId;
+    int displayStreamId;    // Stream shown in imageLabel
+    QHash<int, DetectionResult> lastResults;   // Latest detections per stream
+    QHash<int, LatencyStats> videoLatency;      // Frame capture to paint
+    QHash<int, LatencyStats> detectionLatency;  // Frame capture to its boxes being painted
+    QString latencyOverlay;                     // Refreshed with the stream stats
     VideoReader *videoReader;
     QThread *videoThread;
 };
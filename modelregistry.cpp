@@ -0,0 +1,240 @@
+#include "modelregistry.h"
+#include <QCoreApplication>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutex>
+#include <QRegularExpression>
+#include <QTextStream>
+
+#ifndef EXPAND
+#define STRINGIFY(x) #x
+#define EXPAND(x) STRINGIFY(x)
+#endif
+
+namespace {
+
+QMutex registryMutex;
+
+QStringList &searchPaths() {
+    static QStringList paths;
+    return paths;
+}
+
+// Reads width, height and letter_box from the [net] section
+void readDarknetConfig(const QString &cfgPath, ModelInfo &info) {
+    QFile file(cfgPath);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        qDebug() << "Failed to read Darknet config" << cfgPath;
+        return;
+    }
+
+    static const QRegularExpression assignment("^\\s*(\\w+)\\s*=\\s*(\\S+)");
+    QTextStream in(&file);
+    bool inNet = false;
+    while (!in.atEnd()) {
+        QString line = in.readLine().trimmed();
+        if (line.startsWith('[')) {
+            if (inNet) {
+                break;
+            }
+            inNet = line == "[net]";
+            continue;
+        }
+        QRegularExpressionMatch match = assignment.match(line);
+        if (!inNet || !match.hasMatch()) {
+            continue;
+        }
+        const QString key = match.captured(1);
+        const int value = match.captured(2).toInt();
+        if (key == "width") {
+            info.inputSize.width = value;
+        } else if (key == "height") {
+            info.inputSize.height = value;
+        } else if (key == "letter_box") {
+            info.letterbox = value != 0;
+        }
+    }
+}
+
+ModelInfo builtinModel() {
+    ModelInfo info;
+    info.name = ModelRegistry::DEFAULT_MODEL;
+    info.format = ModelInfo::Darknet;
+    info.layout = YoloDecoder::Region;
+    info.modelPath = ":/models/yolov4-tiny.weights";
+    info.configPath = ":/models/yolov4-tiny.cfg";
+    info.classesPath = ":/models/coco.names";
+    info.dynamicInput = true;
+    readDarknetConfig(info.configPath, info);
+    return info;
+}
+
+void ensureDefaultPaths() {
+    static bool added = false;
+    if (added) {
+        return;
+    }
+    added = true;
+    if (QCoreApplication::instance()) {
+        searchPaths() << QCoreApplication::applicationDirPath() + "/models";
+    }
+    searchPaths() << QString(EXPAND(PROJECT_PATH)) + "/models";
+}
+
+} // namespace
+
+const char *ModelInfo::precisionName(Precision precision) {
+    switch (precision) {
+    case Fp16:
+        return "fp16";
+    case Int8:
+        return "int8";
+    default:
+        return "fp32";
+    }
+}
+
+bool ModelInfo::parsePrecision(const QString &name, Precision &precision) {
+    for (Precision candidate : { Fp32, Fp16, Int8 }) {
+        if (name.compare(QLatin1String(precisionName(candidate)), Qt::CaseInsensitive) == 0) {
+            precision = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+void ModelRegistry::addSearchPath(const QString &dir) {
+    QMutexLocker locker(&registryMutex);
+    ensureDefaultPaths();
+    if (!searchPaths().contains(dir)) {
+        searchPaths().prepend(dir);
+    }
+}
+
+QList<ModelInfo> ModelRegistry::models() {
+    QStringList paths;
+    {
+        QMutexLocker locker(&registryMutex);
+        ensureDefaultPaths();
+        paths = searchPaths();
+    }
+
+    // Manifests are re-read on every call, so new models need no restart;
+    // the first entry of a name wins
+    QList<ModelInfo> result = { builtinModel() };
+    QStringList seen = { result.first().name };
+    for (const QString &dir : paths) {
+        const QFileInfoList manifests = QDir(dir).entryInfoList({ "*.json" }, QDir::Files, QDir::Name);
+        for (const QFileInfo &manifest : manifests) {
+            ModelInfo info;
+            if (readManifest(manifest.absoluteFilePath(), info) && !seen.contains(info.name)) {
+                seen << info.name;
+                result << info;
+            }
+        }
+    }
+    return result;
+}
+
+QStringList ModelRegistry::names() {
+    QStringList result;
+    for (const ModelInfo &info : models()) {
+        result << info.name;
+    }
+    return result;
+}
+
+bool ModelRegistry::find(const QString &name, ModelInfo &info) {
+    const QString wanted = name.isEmpty() ? QString(DEFAULT_MODEL) : name;
+    for (const ModelInfo &candidate : models()) {
+        if (candidate.name == wanted) {
+            info = candidate;
+            return true;
+        }
+    }
+    qDebug() << "Unknown model" << wanted << "- known:" << names();
+    return false;
+}
+
+bool ModelRegistry::readManifest(const QString &path, ModelInfo &info) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qDebug() << "Failed to open model manifest" << path;
+        return false;
+    }
+
+    QJsonParseError error;
+    const QJsonDocument document = QJsonDocument::fromJson(file.readAll(), &error);
+    if (!document.isObject()) {
+        qDebug() << "Invalid model manifest" << path << error.errorString();
+        return false;
+    }
+
+    const QJsonObject json = document.object();
+    const QDir base = QFileInfo(path).absoluteDir();
+    auto resolve = [&](const QString &key) {
+        QString value = json.value(key).toString();
+        if (value.isEmpty() || value.startsWith(":/") || QFileInfo(value).isAbsolute()) {
+            return value;
+        }
+        return base.absoluteFilePath(value);
+    };
+
+    info = ModelInfo();
+    info.name = json.value("name").toString(QFileInfo(path).completeBaseName());
+    info.modelPath = resolve("model");
+    info.configPath = resolve("config");
+    info.classesPath = resolve("classes");
+    info.calibrationPath = resolve("calibration");
+    info.confidenceThreshold = static_cast<float>(json.value("confidence").toDouble(ModelInfo::DEFAULT_CONFIDENCE_THRESHOLD));
+    info.nmsThreshold = static_cast<float>(json.value("nms").toDouble(ModelInfo::DEFAULT_NMS_THRESHOLD));
+
+    const QString format = json.value("format").toString("onnx").toLower();
+    if (format == "darknet") {
+        info.format = ModelInfo::Darknet;
+        info.layout = YoloDecoder::Region;
+        info.dynamicInput = true;
+        readDarknetConfig(info.configPath, info);
+    } else if (format == "onnx") {
+        info.format = ModelInfo::Onnx;
+        const QString decoder = json.value("decoder").toString("anchor-free").toLower();
+        if (decoder == "anchor-based") {
+            info.layout = YoloDecoder::AnchorBased;
+        } else if (decoder == "anchor-free") {
+            info.layout = YoloDecoder::AnchorFree;
+        } else {
+            qDebug() << "Unknown decoder" << decoder << "in" << path;
+            return false;
+        }
+        info.letterbox = json.value("letterbox").toBool(true);
+        info.dynamicInput = json.value("dynamicInput").toBool(false);
+        info.quantized = json.value("quantized").toBool(false);
+        if (info.quantized) {
+            info.precision = ModelInfo::Int8;
+        }
+    } else {
+        qDebug() << "Unknown model format" << format << "in" << path;
+        return false;
+    }
+
+    // The manifest may override what a Darknet .cfg says
+    const QJsonArray input = json.value("input").toArray();
+    if (input.size() == 2) {
+        info.inputSize = cv::Size(input.at(0).toInt(), input.at(1).toInt());
+    }
+    if (json.contains("letterbox")) {
+        info.letterbox = json.value("letterbox").toBool();
+    }
+
+    if (!info.isValid()) {
+        qDebug() << "Incomplete model manifest" << path;
+        return false;
+    }
+    return true;
+}
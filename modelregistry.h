@@ -0,0 +1,78 @@
+#ifndef MODELREGISTRY_H
+#define MODELREGISTRY_H
+
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <opencv2/core.hpp>
+#include "yolodecoder.h"
+
+// Everything needed to load a detector and read its output
+struct ModelInfo {
+    enum Format {
+        Darknet = 0,    // .cfg + .weights
+        Onnx
+    };
+
+    enum Precision {
+        Fp32 = 0,
+        Fp16,           // DNN_TARGET_CPU_FP16 where this OpenCV and CPU have it
+        Int8            // Pre-quantized ONNX, or calibrated at load time
+    };
+
+    static constexpr float DEFAULT_CONFIDENCE_THRESHOLD = 0.5f;
+    static constexpr float DEFAULT_NMS_THRESHOLD = 0.4f;
+    static constexpr int CALIBRATION_FRAMES = 32;   // Post-training INT8 calibration inputs
+
+    QString name;
+    Format format = Darknet;
+    YoloDecoder::Layout layout = YoloDecoder::Region;
+    QString modelPath;          // .weights or .onnx; ":/" paths are resources
+    QString configPath;         // Darknet only
+    QString classesPath;        // One class name per line
+    cv::Size inputSize;
+    bool dynamicInput = false;  // Accepts any multiple of 32, so crops run at native scale
+    float confidenceThreshold = DEFAULT_CONFIDENCE_THRESHOLD;
+    float nmsThreshold = DEFAULT_NMS_THRESHOLD;
+    bool letterbox = false;     // Trained on letterboxed inputs
+    Precision precision = Fp32; // Requested; the backend records what it got
+    bool quantized = false;     // The model file itself is INT8 (QDQ/QLinear ONNX)
+    QString calibrationPath;    // Image directory or clip for calibrating an FP32 model to INT8
+
+    static const char *precisionName(Precision precision);
+    static bool parsePrecision(const QString &name, Precision &precision);
+
+    // Darknet nets take any multiple of 32; ONNX only when exported with dynamic axes
+    bool resizable() const { return dynamicInput || format == Darknet; }
+
+    bool isValid() const { return !name.isEmpty() && !modelPath.isEmpty() && inputSize.area() > 0; }
+};
+
+// Models known to this build: the bundled yolov4-tiny plus one entry per
+// JSON manifest in the search directories, e.g.
+//
+//   { "name": "yolov8n", "format": "onnx", "decoder": "anchor-free",
+//     "model": "yolov8n.onnx", "classes": "coco.names",
+//     "input": [640, 640], "confidence": 0.25, "nms": 0.45, "letterbox": true }
+//
+// "quantized": true marks an INT8 model file; "calibration" names images or
+// a clip used to quantize an FP32 model when INT8 is requested.
+//
+// Relative paths resolve against the manifest. Darknet entries take their
+// input size and letterboxing from the [net] section of the .cfg instead.
+class ModelRegistry
+{
+public:
+    static constexpr const char *DEFAULT_MODEL = "yolov4-tiny";
+
+    // <executable>/models and <project>/models are searched by default
+    static void addSearchPath(const QString &dir);
+
+    static QList<ModelInfo> models();
+    static QStringList names();
+    static bool find(const QString &name, ModelInfo &info);
+
+    static bool readManifest(const QString &path, ModelInfo &info);
+};
+
+#endif // MODELREGISTRY_H
@@ -0,0 +1,83 @@
+#include "motiongate.h"
+
+MotionGate::Result MotionGate::evaluate(const cv::Mat &frame) {
+    Result result;
+    if (frame.empty()) {
+        return result;
+    }
+    std::lock_guard<std::mutex> locker(m_mutex);
+
+    // Area averaging doubles as noise suppression. A luma plane is already
+    // grayscale.
+    if (frame.channels() == 1) {
+        cv::resize(frame, m_gray, cv::Size(SAMPLE_SIZE, SAMPLE_SIZE), 0, 0, cv::INTER_AREA);
+    } else {
+        cv::resize(frame, m_small, cv::Size(SAMPLE_SIZE, SAMPLE_SIZE), 0, 0, cv::INTER_AREA);
+        cv::cvtColor(m_small, m_gray, cv::COLOR_BGR2GRAY);
+    }
+
+    if (m_background.empty()) {
+        m_gray.convertTo(m_background, CV_32F);
+        m_sinceFull = 0;
+        return result;
+    }
+
+    cv::Mat background8u;
+    m_background.convertTo(background8u, CV_8U);
+    cv::absdiff(m_gray, background8u, m_diff);
+    cv::threshold(m_diff, m_mask, PIXEL_THRESHOLD, 1, cv::THRESH_BINARY);
+    cv::accumulateWeighted(m_gray, m_background, BACKGROUND_RATE);
+
+    const int tile = SAMPLE_SIZE / GRID;
+    const int changedLimit = static_cast<int>(TILE_CHANGE_RATIO * tile * tile);
+    int minX = GRID, minY = GRID, maxX = -1, maxY = -1;
+    for (int ty = 0; ty < GRID; ++ty) {
+        for (int tx = 0; tx < GRID; ++tx) {
+            int changed = cv::countNonZero(m_mask(cv::Rect(tx * tile, ty * tile, tile, tile)));
+            if (changed > changedLimit) {
+                ++result.changedTiles;
+                minX = std::min(minX, tx);
+                minY = std::min(minY, ty);
+                maxX = std::max(maxX, tx);
+                maxY = std::max(maxY, ty);
+            }
+        }
+    }
+
+    // Reused detections drift from reality eventually; refresh them
+    if (++m_sinceFull >= REFRESH_INTERVAL) {
+        m_sinceFull = 0;
+        return result;
+    }
+
+    if (result.changedTiles == 0) {
+        result.decision = Skip;
+        return result;
+    }
+
+    minX = std::max(0, minX - CROP_MARGIN_TILES);
+    minY = std::max(0, minY - CROP_MARGIN_TILES);
+    maxX = std::min(GRID - 1, maxX + CROP_MARGIN_TILES);
+    maxY = std::min(GRID - 1, maxY + CROP_MARGIN_TILES);
+
+    float area = static_cast<float>((maxX - minX + 1) * (maxY - minY + 1)) / (GRID * GRID);
+    if (area > FULL_FRAME_AREA) {
+        m_sinceFull = 0;
+        return result;
+    }
+
+    // Tile grid back to frame pixels
+    int x0 = minX * frame.cols / GRID;
+    int y0 = minY * frame.rows / GRID;
+    int x1 = (maxX + 1) * frame.cols / GRID;
+    int y1 = (maxY + 1) * frame.rows / GRID;
+    result.decision = Crop;
+    result.roi = cv::Rect(x0, y0, x1 - x0, y1 - y0);
+    return result;
+}
+
+void MotionGate::reset() {
+    std::lock_guard<std::mutex> locker(m_mutex);
+    m_background.release();
+    m_sinceFull = 0;
+}
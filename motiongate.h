@@ -0,0 +1,51 @@
+#ifndef MOTIONGATE_H
+#define MOTIONGATE_H
+
+#include <mutex>
+#include <opencv2/opencv.hpp>
+
+// Cheap change detector in front of the detector. Each frame is reduced to a
+// small grayscale image and compared, tile by tile, against a running-average
+// background. Static scenes skip inference and reuse the last detections;
+// local motion is inferred on a crop around the changed tiles only.
+// Detection workers evaluate it, so frames of one stream may arrive from
+// several threads; evaluate() and reset() serialise on the gate's own mutex.
+class MotionGate
+{
+public:
+    static constexpr int SAMPLE_SIZE = 64;              // Side of the grayscale thumbnail
+    static constexpr int GRID = 8;                      // Tiles per side
+    static constexpr int PIXEL_THRESHOLD = 16;          // Gray levels that count as change
+    static constexpr float TILE_CHANGE_RATIO = 0.05f;   // Changed pixels that mark a tile
+    static constexpr double BACKGROUND_RATE = 0.05;     // Running average weight of a new frame
+    static constexpr int CROP_MARGIN_TILES = 1;         // Context around changed tiles
+    static constexpr float FULL_FRAME_AREA = 0.5f;      // Larger crops run the full frame
+    static constexpr int REFRESH_INTERVAL = 50;         // Full inference at least this often
+
+    enum Decision {
+        Skip = 0,   // Nothing changed, reuse the last detections
+        Crop,       // Infer roi only
+        Full        // Infer the whole frame
+    };
+
+    struct Result {
+        Decision decision = Full;
+        cv::Rect roi;            // In frame pixels, for Crop
+        int changedTiles = 0;
+    };
+
+    // frame: BGR or grayscale (a Y plane)
+    Result evaluate(const cv::Mat &frame);
+    void reset();
+
+private:
+    std::mutex m_mutex;
+    cv::Mat m_background;    // CV_32F running average
+    cv::Mat m_gray;
+    cv::Mat m_small;
+    cv::Mat m_diff;
+    cv::Mat m_mask;
+    int m_sinceFull = 0;
+};
+
+#endif // MOTIONGATE_H
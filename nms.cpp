@@ -0,0 +1,129 @@
+#include "nms.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+inline float overlap(float a0, float a1, float b0, float b1) {
+    return std::max(0.0f, std::min(a1, b1) - std::max(a0, b0));
+}
+
+} // namespace
+
+void Nms::run(DetectionCandidates &candidates, const Config &config, std::vector<int> &keep) {
+    keep.clear();
+
+    // Sort once: by image, by class when per class, then by falling score.
+    // Ties keep decode order so results are deterministic.
+    order.clear();
+    for (int i = 0; i < candidates.size(); ++i) {
+        if (candidates.score[i] > config.scoreThreshold) {
+            order.push_back(i);
+        }
+    }
+    const bool perClass = config.scope == PerClass;
+    std::sort(order.begin(), order.end(), [&](int a, int b) {
+        if (candidates.image[a] != candidates.image[b]) {
+            return candidates.image[a] < candidates.image[b];
+        }
+        if (perClass && candidates.classId[a] != candidates.classId[b]) {
+            return candidates.classId[a] < candidates.classId[b];
+        }
+        if (candidates.score[a] != candidates.score[b]) {
+            return candidates.score[a] > candidates.score[b];
+        }
+        return a < b;
+    });
+
+    const int total = static_cast<int>(order.size());
+    for (int begin = 0; begin < total;) {
+        int first = order[begin];
+        int end = begin + 1;
+        while (end < total && candidates.image[order[end]] == candidates.image[first]
+               && (!perClass || candidates.classId[order[end]] == candidates.classId[first])) {
+            ++end;
+        }
+
+        loadBucket(candidates, begin, end);
+        if (config.soft) {
+            softBucket(end - begin, config, begin, candidates, keep);
+        } else {
+            hardBucket(end - begin, config, begin, keep);
+        }
+        begin = end;
+    }
+}
+
+void Nms::loadBucket(const DetectionCandidates &candidates, int begin, int end) {
+    const int count = end - begin;
+    for (std::vector<float> *field : { &x0, &y0, &x1, &y1, &area, &score }) {
+        field->resize(count);
+    }
+    suppressed.assign(count, 0);
+    for (int k = 0; k < count; ++k) {
+        int i = order[begin + k];
+        x0[k] = candidates.left[i];
+        y0[k] = candidates.top[i];
+        x1[k] = candidates.left[i] + candidates.width[i];
+        y1[k] = candidates.top[i] + candidates.height[i];
+        area[k] = candidates.width[i] * candidates.height[i];
+        score[k] = candidates.score[i];
+    }
+}
+
+void Nms::hardBucket(int count, const Config &config, int begin, std::vector<int> &keep) {
+    const float threshold = config.iouThreshold;
+    int kept = 0;
+    for (int i = 0; i < count; ++i) {
+        if (suppressed[i]) {
+            continue;
+        }
+        keep.push_back(order[begin + i]);
+        if (++kept == config.maxPerBucket) {
+            break;
+        }
+
+        // iou > t without the division: inter > t * union
+        const float ax0 = x0[i], ay0 = y0[i], ax1 = x1[i], ay1 = y1[i], aArea = area[i];
+        for (int j = i + 1; j < count; ++j) {
+            float inter = overlap(ax0, ax1, x0[j], x1[j]) * overlap(ay0, ay1, y0[j], y1[j]);
+            suppressed[j] |= static_cast<uint8_t>(inter > threshold * (aArea + area[j] - inter));
+        }
+    }
+}
+
+void Nms::softBucket(int count, const Config &config, int begin, DetectionCandidates &candidates,
+                     std::vector<int> &keep) {
+    // Scores change as boxes are kept, so each round picks the best survivor
+    const float sigma = std::max(config.sigma, 1e-6f);
+    int kept = 0;
+    while (config.maxPerBucket <= 0 || kept < config.maxPerBucket) {
+        int best = -1;
+        for (int j = 0; j < count; ++j) {
+            if (!suppressed[j] && (best < 0 || score[j] > score[best])) {
+                best = j;
+            }
+        }
+        if (best < 0) {
+            break;
+        }
+        suppressed[best] = 1;
+        keep.push_back(order[begin + best]);
+        candidates.score[order[begin + best]] = score[best];
+        ++kept;
+
+        const float ax0 = x0[best], ay0 = y0[best], ax1 = x1[best], ay1 = y1[best], aArea = area[best];
+        for (int j = 0; j < count; ++j) {
+            if (suppressed[j]) {
+                continue;
+            }
+            float inter = overlap(ax0, ax1, x0[j], x1[j]) * overlap(ay0, ay1, y0[j], y1[j]);
+            float unionArea = aArea + area[j] - inter;
+            float iou = unionArea > 0.0f ? inter / unionArea : 0.0f;
+            score[j] *= std::exp(-(iou * iou) / sigma);
+            if (!(score[j] > config.scoreThreshold)) {
+                suppressed[j] = 1;
+            }
+        }
+    }
+}
@@ -0,0 +1,53 @@
+#ifndef NMS_H
+#define NMS_H
+
+#include <cstdint>
+#include <vector>
+#include "yolodecoder.h"
+
+// Non-maximum suppression over DetectionCandidates. Candidates are bucketed
+// by image and (per class) by class, sorted by score once, and each kept
+// box suppresses the rest of its bucket in a branch-free loop over float
+// SoA coordinates that the compiler vectorises. A whole batch goes through
+// in one call; images never suppress each other.
+class Nms
+{
+public:
+    enum Scope {
+        PerClass = 0,       // A person does not suppress an overlapping bicycle
+        ClassAgnostic       // One bucket per image, like a single NMSBoxes call
+    };
+
+    static constexpr float DEFAULT_SOFT_SIGMA = 0.5f;
+
+    struct Config {
+        Scope scope = PerClass;
+        float iouThreshold = 0.4f;      // Suppress above this overlap
+        float scoreThreshold = 0.5f;    // Candidates, and decayed Soft-NMS scores, must exceed it
+        bool soft = false;              // Gaussian Soft-NMS: decay overlapping scores instead of dropping
+        float sigma = DEFAULT_SOFT_SIGMA;
+        int maxPerBucket = 0;           // Stop a bucket after this many boxes; 0 keeps all
+    };
+
+    // keep receives candidate indices grouped by image, best first within a
+    // bucket. With Soft-NMS, candidates.score holds the decayed scores.
+    void run(DetectionCandidates &candidates, const Config &config, std::vector<int> &keep);
+
+private:
+    // Scratch for one bucket, reused across calls
+    std::vector<int> order;
+    std::vector<float> x0;
+    std::vector<float> y0;
+    std::vector<float> x1;
+    std::vector<float> y1;
+    std::vector<float> area;
+    std::vector<float> score;
+    std::vector<uint8_t> suppressed;
+
+    void loadBucket(const DetectionCandidates &candidates, int begin, int end);
+    void hardBucket(int count, const Config &config, int begin, std::vector<int> &keep);
+    void softBucket(int count, const Config &config, int begin, DetectionCandidates &candidates,
+                    std::vector<int> &keep);
+};
+
+#endif // NMS_H
@@ -0,0 +1,522 @@
+#include "preprocesskernels.h"
+#include "cpufeatures.h"
+#include <QDebug>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define PREPROCESS_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(__aarch64__) || defined(_M_ARM64) || defined(__ARM_NEON)
+#define PREPROCESS_NEON 1
+#include <arm_neon.h>
+#endif
+
+// Bit-exactness needs every multiply and add rounded separately. GCC is
+// told the same with -ffp-contract=off in the project file.
+#if defined(__clang__)
+#pragma STDC FP_CONTRACT OFF
+#endif
+
+namespace {
+
+constexpr float NORM = 1.0f / 255.0f;
+
+inline float clamp01(float v) {
+    return std::min(std::max(v, 0.0f), 1.0f);
+}
+
+// Reference implementations; the vector variants mirror their operation order
+
+void bgrRowScalar(const uint8_t *bgr, int count, float *r, float *g, float *b) {
+    for (int i = 0; i < count; ++i) {
+        b[i] = static_cast<float>(bgr[3 * i]) * NORM;
+        g[i] = static_cast<float>(bgr[3 * i + 1]) * NORM;
+        r[i] = static_cast<float>(bgr[3 * i + 2]) * NORM;
+    }
+}
+
+void yuvRowScalar(const uint8_t *y, const uint8_t *u, const uint8_t *v, int count,
+                  const YuvCoefficients &k, float *r, float *g, float *b) {
+    for (int i = 0; i < count; ++i) {
+        float yn = (static_cast<float>(y[i]) - k.yOffset) * k.yScale;
+        float uf = static_cast<float>(u[i]) - 128.0f;
+        float vf = static_cast<float>(v[i]) - 128.0f;
+        r[i] = clamp01(yn + k.rv * vf);
+        g[i] = clamp01((yn + k.gu * uf) + k.gv * vf);
+        b[i] = clamp01(yn + k.bu * uf);
+    }
+}
+
+#ifdef PREPROCESS_X86
+
+// pshufb masks picking channel c of 16 consecutive pixels out of 16-byte
+// chunk k of the packed row; 0x80 zeroes a lane. AVX2 uses the first 8.
+struct ShuffleMasks {
+    alignas(16) int8_t bytes[3][3][16];
+
+    ShuffleMasks() {
+        for (int c = 0; c < 3; ++c) {
+            for (int k = 0; k < 3; ++k) {
+                for (int p = 0; p < 16; ++p) {
+                    int index = 3 * p + c - 16 * k;
+                    bytes[c][k][p] = index >= 0 && index < 16 ? static_cast<int8_t>(index) : static_cast<int8_t>(0x80);
+                }
+            }
+        }
+    }
+
+    // Only the AVX2 and AVX-512 kernels call it, so it shares their target
+    // rather than assuming SSE2 in the baseline (i386)
+    CPU_TARGET("avx2")
+    __m128i mask(int c, int k) const {
+        return _mm_load_si128(reinterpret_cast<const __m128i *>(bytes[c][k]));
+    }
+};
+
+const ShuffleMasks &shuffleMasks() {
+    static const ShuffleMasks masks;
+    return masks;
+}
+
+CPU_TARGET("avx2")
+void bgrRowAvx2(const uint8_t *bgr, int count, float *r, float *g, float *b) {
+    const ShuffleMasks &masks = shuffleMasks();
+    __m128i lo[3];
+    __m128i hi[3];
+    for (int c = 0; c < 3; ++c) {
+        lo[c] = masks.mask(c, 0);
+        hi[c] = masks.mask(c, 1);
+    }
+    const __m256 norm = _mm256_set1_ps(NORM);
+    float *out[3] = { b, g, r };
+
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        // Exactly the 24 bytes of 8 pixels
+        const uint8_t *p = bgr + 3 * i;
+        __m128i first = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        __m128i second = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(p + 16));
+        for (int c = 0; c < 3; ++c) {
+            __m128i bytes = _mm_or_si128(_mm_shuffle_epi8(first, lo[c]), _mm_shuffle_epi8(second, hi[c]));
+            __m256 f = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(bytes));
+            _mm256_storeu_ps(out[c] + i, _mm256_mul_ps(f, norm));
+        }
+    }
+    bgrRowScalar(bgr + 3 * i, count - i, r + i, g + i, b + i);
+}
+
+CPU_TARGET("avx2")
+inline __m256 loadAvx2(const uint8_t *p) {
+    return _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(p))));
+}
+
+CPU_TARGET("avx2")
+inline __m256 clampAvx2(__m256 v, __m256 zero, __m256 one) {
+    // Operand order matches std::max(v, 0) / std::min(v, 1) on equal inputs
+    return _mm256_min_ps(_mm256_max_ps(zero, v), one);
+}
+
+CPU_TARGET("avx2")
+void yuvRowAvx2(const uint8_t *y, const uint8_t *u, const uint8_t *v, int count,
+                const YuvCoefficients &k, float *r, float *g, float *b) {
+    const __m256 yOffset = _mm256_set1_ps(k.yOffset);
+    const __m256 yScale = _mm256_set1_ps(k.yScale);
+    const __m256 rv = _mm256_set1_ps(k.rv);
+    const __m256 gu = _mm256_set1_ps(k.gu);
+    const __m256 gv = _mm256_set1_ps(k.gv);
+    const __m256 bu = _mm256_set1_ps(k.bu);
+    const __m256 bias = _mm256_set1_ps(128.0f);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one = _mm256_set1_ps(1.0f);
+
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 yn = _mm256_mul_ps(_mm256_sub_ps(loadAvx2(y + i), yOffset), yScale);
+        __m256 uf = _mm256_sub_ps(loadAvx2(u + i), bias);
+        __m256 vf = _mm256_sub_ps(loadAvx2(v + i), bias);
+        __m256 rf = _mm256_add_ps(yn, _mm256_mul_ps(rv, vf));
+        __m256 gf = _mm256_add_ps(_mm256_add_ps(yn, _mm256_mul_ps(gu, uf)), _mm256_mul_ps(gv, vf));
+        __m256 bf = _mm256_add_ps(yn, _mm256_mul_ps(bu, uf));
+        _mm256_storeu_ps(r + i, clampAvx2(rf, zero, one));
+        _mm256_storeu_ps(g + i, clampAvx2(gf, zero, one));
+        _mm256_storeu_ps(b + i, clampAvx2(bf, zero, one));
+    }
+    yuvRowScalar(y + i, u + i, v + i, count - i, k, r + i, g + i, b + i);
+}
+
+CPU_TARGET("avx512f")
+void bgrRowAvx512(const uint8_t *bgr, int count, float *r, float *g, float *b) {
+    const ShuffleMasks &masks = shuffleMasks();
+    __m128i mask[3][3];
+    for (int c = 0; c < 3; ++c) {
+        for (int k = 0; k < 3; ++k) {
+            mask[c][k] = masks.mask(c, k);
+        }
+    }
+    const __m512 norm = _mm512_set1_ps(NORM);
+    float *out[3] = { b, g, r };
+
+    int i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const uint8_t *p = bgr + 3 * i;
+        __m128i chunk[3];
+        for (int k = 0; k < 3; ++k) {
+            chunk[k] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 16 * k));
+        }
+        for (int c = 0; c < 3; ++c) {
+            __m128i bytes = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(chunk[0], mask[c][0]),
+                                                      _mm_shuffle_epi8(chunk[1], mask[c][1])),
+                                         _mm_shuffle_epi8(chunk[2], mask[c][2]));
+            __m512 f = _mm512_cvtepi32_ps(_mm512_cvtepu8_epi32(bytes));
+            _mm512_storeu_ps(out[c] + i, _mm512_mul_ps(f, norm));
+        }
+    }
+    bgrRowScalar(bgr + 3 * i, count - i, r + i, g + i, b + i);
+}
+
+CPU_TARGET("avx512f")
+inline __m512 loadAvx512(const uint8_t *p) {
+    return _mm512_cvtepi32_ps(_mm512_cvtepu8_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p))));
+}
+
+CPU_TARGET("avx512f")
+inline __m512 clampAvx512(__m512 v, __m512 zero, __m512 one) {
+    return _mm512_min_ps(_mm512_max_ps(zero, v), one);
+}
+
+CPU_TARGET("avx512f")
+void yuvRowAvx512(const uint8_t *y, const uint8_t *u, const uint8_t *v, int count,
+                  const YuvCoefficients &k, float *r, float *g, float *b) {
+    const __m512 yOffset = _mm512_set1_ps(k.yOffset);
+    const __m512 yScale = _mm512_set1_ps(k.yScale);
+    const __m512 rv = _mm512_set1_ps(k.rv);
+    const __m512 gu = _mm512_set1_ps(k.gu);
+    const __m512 gv = _mm512_set1_ps(k.gv);
+    const __m512 bu = _mm512_set1_ps(k.bu);
+    const __m512 bias = _mm512_set1_ps(128.0f);
+    const __m512 zero = _mm512_setzero_ps();
+    const __m512 one = _mm512_set1_ps(1.0f);
+
+    int i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m512 yn = _mm512_mul_ps(_mm512_sub_ps(loadAvx512(y + i), yOffset), yScale);
+        __m512 uf = _mm512_sub_ps(loadAvx512(u + i), bias);
+        __m512 vf = _mm512_sub_ps(loadAvx512(v + i), bias);
+        __m512 rf = _mm512_add_ps(yn, _mm512_mul_ps(rv, vf));
+        __m512 gf = _mm512_add_ps(_mm512_add_ps(yn, _mm512_mul_ps(gu, uf)), _mm512_mul_ps(gv, vf));
+        __m512 bf = _mm512_add_ps(yn, _mm512_mul_ps(bu, uf));
+        _mm512_storeu_ps(r + i, clampAvx512(rf, zero, one));
+        _mm512_storeu_ps(g + i, clampAvx512(gf, zero, one));
+        _mm512_storeu_ps(b + i, clampAvx512(bf, zero, one));
+    }
+    yuvRowScalar(y + i, u + i, v + i, count - i, k, r + i, g + i, b + i);
+}
+
+#endif // PREPROCESS_X86
+
+#ifdef PREPROCESS_NEON
+
+// Eight bytes to two float quads
+inline void widenNeon(uint8x8_t bytes, float32x4_t &lo, float32x4_t &hi) {
+    uint16x8_t wide = vmovl_u8(bytes);
+    lo = vcvtq_f32_u32(vmovl_u16(vget_low_u16(wide)));
+    hi = vcvtq_f32_u32(vmovl_u16(vget_high_u16(wide)));
+}
+
+inline void storeNormNeon(uint8x8_t bytes, float *dst, float32x4_t norm) {
+    float32x4_t lo;
+    float32x4_t hi;
+    widenNeon(bytes, lo, hi);
+    vst1q_f32(dst, vmulq_f32(lo, norm));
+    vst1q_f32(dst + 4, vmulq_f32(hi, norm));
+}
+
+void bgrRowNeon(const uint8_t *bgr, int count, float *r, float *g, float *b) {
+    const float32x4_t norm = vdupq_n_f32(NORM);
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        // vld3 de-interleaves B, G and R itself
+        uint8x8x3_t pixels = vld3_u8(bgr + 3 * i);
+        storeNormNeon(pixels.val[0], b + i, norm);
+        storeNormNeon(pixels.val[1], g + i, norm);
+        storeNormNeon(pixels.val[2], r + i, norm);
+    }
+    bgrRowScalar(bgr + 3 * i, count - i, r + i, g + i, b + i);
+}
+
+struct YuvNeon {
+    float32x4_t yOffset, yScale, rv, gu, gv, bu, bias, zero, one;
+
+    explicit YuvNeon(const YuvCoefficients &k)
+        : yOffset(vdupq_n_f32(k.yOffset)), yScale(vdupq_n_f32(k.yScale)),
+          rv(vdupq_n_f32(k.rv)), gu(vdupq_n_f32(k.gu)), gv(vdupq_n_f32(k.gv)), bu(vdupq_n_f32(k.bu)),
+          bias(vdupq_n_f32(128.0f)), zero(vdupq_n_f32(0.0f)), one(vdupq_n_f32(1.0f)) {}
+
+    float32x4_t clamp(float32x4_t v) const {
+        return vminq_f32(vmaxq_f32(v, zero), one);
+    }
+
+    void convert(float32x4_t yv, float32x4_t uv, float32x4_t vv, float *r, float *g, float *b) const {
+        float32x4_t yn = vmulq_f32(vsubq_f32(yv, yOffset), yScale);
+        float32x4_t uf = vsubq_f32(uv, bias);
+        float32x4_t vf = vsubq_f32(vv, bias);
+        vst1q_f32(r, clamp(vaddq_f32(yn, vmulq_f32(rv, vf))));
+        vst1q_f32(g, clamp(vaddq_f32(vaddq_f32(yn, vmulq_f32(gu, uf)), vmulq_f32(gv, vf))));
+        vst1q_f32(b, clamp(vaddq_f32(yn, vmulq_f32(bu, uf))));
+    }
+};
+
+void yuvRowNeon(const uint8_t *y, const uint8_t *u, const uint8_t *v, int count,
+                const YuvCoefficients &k, float *r, float *g, float *b) {
+    const YuvNeon neon(k);
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        float32x4_t y0, y1, u0, u1, v0, v1;
+        widenNeon(vld1_u8(y + i), y0, y1);
+        widenNeon(vld1_u8(u + i), u0, u1);
+        widenNeon(vld1_u8(v + i), v0, v1);
+        neon.convert(y0, u0, v0, r + i, g + i, b + i);
+        neon.convert(y1, u1, v1, r + i + 4, g + i + 4, b + i + 4);
+    }
+    yuvRowScalar(y + i, u + i, v + i, count - i, k, r + i, g + i, b + i);
+}
+
+#endif // PREPROCESS_NEON
+
+PreprocessKernels::Isa bestIsa() {
+    for (PreprocessKernels::Isa isa : { PreprocessKernels::Avx512, PreprocessKernels::Avx2, PreprocessKernels::Neon }) {
+        if (PreprocessKernels::available(isa)) {
+            return isa;
+        }
+    }
+    return PreprocessKernels::Scalar;
+}
+
+const PreprocessKernels::Table &tableFor(PreprocessKernels::Isa isa) {
+    static const PreprocessKernels::Table tables[] = {
+        PreprocessKernels::forIsa(PreprocessKernels::Scalar),
+        PreprocessKernels::forIsa(PreprocessKernels::Avx2),
+        PreprocessKernels::forIsa(PreprocessKernels::Avx512),
+        PreprocessKernels::forIsa(PreprocessKernels::Neon),
+    };
+    return tables[isa];
+}
+
+std::atomic<const PreprocessKernels::Table *> &activeTable() {
+    static std::atomic<const PreprocessKernels::Table *> table { nullptr };
+    return table;
+}
+
+// Deterministic bytes so a failing run can be reproduced
+struct TestBytes {
+    uint32_t state = 0x12345678u;
+
+    void fill(std::vector<uint8_t> &bytes) {
+        for (uint8_t &byte : bytes) {
+            state = state * 1664525u + 1013904223u;
+            byte = static_cast<uint8_t>(state >> 24);
+        }
+    }
+};
+
+bool sameFloats(const std::vector<float> &a, const std::vector<float> &b, int &index) {
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (std::memcmp(&a[i], &b[i], sizeof(float)) != 0) {
+            index = static_cast<int>(i);
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+YuvCoefficients PreprocessKernels::yuvCoefficients(float kr, float kb, bool fullRange) {
+    float kg = 1.0f - kr - kb;
+
+    // Limited range stretches luma 16..235 and chroma 16..240
+    float chromaScale = (fullRange ? 1.0f : 255.0f / 224.0f) / 255.0f;
+    YuvCoefficients c;
+    c.yOffset = fullRange ? 0.0f : 16.0f;
+    c.yScale = (fullRange ? 1.0f : 255.0f / 219.0f) / 255.0f;
+    c.rv = 2.0f * (1.0f - kr) * chromaScale;
+    c.bu = 2.0f * (1.0f - kb) * chromaScale;
+    c.gu = -2.0f * (1.0f - kb) * kb / kg * chromaScale;
+    c.gv = -2.0f * (1.0f - kr) * kr / kg * chromaScale;
+    return c;
+}
+
+bool PreprocessKernels::available(Isa isa) {
+    const CpuFeatures &cpu = CpuFeatures::host();
+    switch (isa) {
+    case Scalar:
+        return true;
+#ifdef PREPROCESS_X86
+    case Avx2:
+        return cpu.avx2;
+    case Avx512:
+        return cpu.avx512 && cpu.avx2;
+#endif
+#ifdef PREPROCESS_NEON
+    case Neon:
+        return cpu.neon;
+#endif
+    default:
+        Q_UNUSED(cpu);
+        return false;
+    }
+}
+
+PreprocessKernels::Table PreprocessKernels::forIsa(Isa isa) {
+    Table table;
+    table.isa = Scalar;
+    table.bgr = bgrRowScalar;
+    table.yuv = yuvRowScalar;
+    if (!available(isa)) {
+        return table;
+    }
+
+    switch (isa) {
+#ifdef PREPROCESS_X86
+    case Avx2:
+        table.bgr = bgrRowAvx2;
+        table.yuv = yuvRowAvx2;
+        break;
+    case Avx512:
+        table.bgr = bgrRowAvx512;
+        table.yuv = yuvRowAvx512;
+        break;
+#endif
+#ifdef PREPROCESS_NEON
+    case Neon:
+        table.bgr = bgrRowNeon;
+        table.yuv = yuvRowNeon;
+        break;
+#endif
+    default:
+        return table;
+    }
+    table.isa = isa;
+    return table;
+}
+
+const PreprocessKernels::Table &PreprocessKernels::active() {
+    const Table *table = activeTable().load(std::memory_order_acquire);
+    if (!table) {
+        const Table *best = &tableFor(bestIsa());
+        if (activeTable().compare_exchange_strong(table, best)) {
+            qDebug() << "Preprocessing kernels:" << name(best->isa);
+            table = best;
+        }
+    }
+    return *table;
+}
+
+bool PreprocessKernels::select(Isa isa) {
+    if (!available(isa)) {
+        qDebug() << "Preprocessing kernels" << name(isa) << "not supported on this CPU";
+        return false;
+    }
+    activeTable().store(&tableFor(isa), std::memory_order_release);
+    return true;
+}
+
+const char *PreprocessKernels::name(Isa isa) {
+    switch (isa) {
+    case Avx2:
+        return "avx2";
+    case Avx512:
+        return "avx512";
+    case Neon:
+        return "neon";
+    default:
+        return "scalar";
+    }
+}
+
+bool PreprocessKernels::fromName(const QString &name, Isa &isa) {
+    for (Isa candidate : { Scalar, Avx2, Avx512, Neon }) {
+        if (name.compare(QLatin1String(PreprocessKernels::name(candidate)), Qt::CaseInsensitive) == 0) {
+            isa = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool PreprocessKernels::verify(QStringList *report) {
+    // Lengths straddle every vector width and its tails, plus the 416 input
+    static const int lengths[] = { 1, 2, 3, 7, 8, 9, 15, 16, 17, 23, 31, 32, 33, 47, 63, 64, 65, 127, 416, 417 };
+    const YuvCoefficients coefficients[] = {
+        yuvCoefficients(0.299f, 0.114f, false),
+        yuvCoefficients(0.299f, 0.114f, true),
+        yuvCoefficients(0.2126f, 0.0722f, false),
+        yuvCoefficients(0.2126f, 0.0722f, true),
+    };
+
+    const Table reference = forIsa(Scalar);
+    TestBytes random;
+    bool ok = true;
+
+    for (Isa isa : { Avx2, Avx512, Neon }) {
+        if (!available(isa)) {
+            if (report) {
+                *report << QString("%1: not supported, skipped").arg(name(isa));
+            }
+            continue;
+        }
+
+        const Table table = forIsa(isa);
+        int checked = 0;
+        QString failure;
+        for (int length : lengths) {
+            std::vector<uint8_t> bgr(static_cast<size_t>(length) * 3);
+            std::vector<uint8_t> y(length), u(length), v(length);
+            random.fill(bgr);
+            random.fill(y);
+            random.fill(u);
+            random.fill(v);
+
+            std::vector<float> expected(static_cast<size_t>(length) * 3, -1.0f);
+            std::vector<float> actual(expected);
+            const int n = length;
+            int index = 0;
+
+            reference.bgr(bgr.data(), n, expected.data(), expected.data() + n, expected.data() + 2 * n);
+            table.bgr(bgr.data(), n, actual.data(), actual.data() + n, actual.data() + 2 * n);
+            ++checked;
+            if (!sameFloats(expected, actual, index) && failure.isEmpty()) {
+                failure = QString("bgr length %1 at %2: %3 vs %4")
+                              .arg(length).arg(index).arg(actual[index], 0, 'g', 9).arg(expected[index], 0, 'g', 9);
+            }
+
+            for (const YuvCoefficients &k : coefficients) {
+                std::fill(expected.begin(), expected.end(), -1.0f);
+                std::fill(actual.begin(), actual.end(), -1.0f);
+                reference.yuv(y.data(), u.data(), v.data(), n, k,
+                              expected.data(), expected.data() + n, expected.data() + 2 * n);
+                table.yuv(y.data(), u.data(), v.data(), n, k,
+                          actual.data(), actual.data() + n, actual.data() + 2 * n);
+                ++checked;
+                if (!sameFloats(expected, actual, index) && failure.isEmpty()) {
+                    failure = QString("yuv length %1 at %2: %3 vs %4")
+                                  .arg(length).arg(index).arg(actual[index], 0, 'g', 9).arg(expected[index], 0, 'g', 9);
+                }
+            }
+        }
+
+        if (!failure.isEmpty()) {
+            ok = false;
+        }
+        if (report) {
+            *report << (failure.isEmpty() ? QString("%1: %2 rows bit-exact").arg(name(isa)).arg(checked)
+                                          : QString("%1: MISMATCH %2").arg(name(isa), failure));
+        }
+    }
+    return ok;
+}
@@ -0,0 +1,63 @@
+#ifndef PREPROCESSKERNELS_H
+#define PREPROCESSKERNELS_H
+
+#include <QStringList>
+#include <cstdint>
+
+// Y'CbCr to RGB in 0..1, folded into one multiply per term
+struct YuvCoefficients {
+    float yOffset;
+    float yScale;
+    float rv;
+    float gu;
+    float gv;
+    float bu;
+};
+
+// Row kernels that turn packed 8-bit pixels into the planar float32 RGB the
+// detector reads, scaled to 0..1. Each has a scalar reference and AVX2,
+// AVX-512 and NEON variants; the best one the host supports is picked at
+// first use. All variants use the same operations in the same order, so
+// their output is bit-identical to the reference.
+class PreprocessKernels
+{
+public:
+    enum Isa {
+        Scalar = 0,
+        Avx2,
+        Avx512,
+        Neon
+    };
+
+    // count packed BGR pixels to R, G and B planes
+    using BgrRow = void (*)(const uint8_t *bgr, int count, float *r, float *g, float *b);
+    // count Y, U and V samples (one per pixel, 4:4:4) to R, G and B planes
+    using YuvRow = void (*)(const uint8_t *y, const uint8_t *u, const uint8_t *v, int count,
+                            const YuvCoefficients &k, float *r, float *g, float *b);
+
+    struct Table {
+        Isa isa = Scalar;
+        BgrRow bgr = nullptr;
+        YuvRow yuv = nullptr;
+    };
+
+    // Coefficients for luma weights kr/kb (0.299/0.114 for BT.601)
+    static YuvCoefficients yuvCoefficients(float kr, float kb, bool fullRange);
+
+    static const Table &active();
+    static bool available(Isa isa);
+    static Table forIsa(Isa isa);   // Scalar table when isa is unavailable
+
+    // Overrides the automatic choice, e.g. for benchmarking. Returns false
+    // and keeps the current table when isa is unavailable here.
+    static bool select(Isa isa);
+
+    static const char *name(Isa isa);
+    static bool fromName(const QString &name, Isa &isa);
+
+    // Runs every available variant against the scalar reference over random
+    // rows of awkward lengths. Returns true when all match bit for bit.
+    static bool verify(QStringList *report = nullptr);
+};
+
+#endif // PREPROCESSKERNELS_H
@@ -0,0 +1,191 @@
+#include "preprocessor.h"
+#include "preprocesskernels.h"
+#include <QDebug>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace {
+
+// Bilinear weights in fixed point, as cv::resize does for 8-bit images
+constexpr int WEIGHT_BITS = 11;
+constexpr int WEIGHT_ONE = 1 << WEIGHT_BITS;
+constexpr int ROUND = 1 << (2 * WEIGHT_BITS - 1);
+
+// Source positions for one output axis: both bilinear neighbours, the weight
+// of the second and the nearest sample (used for chroma)
+struct Axis {
+    std::vector<int> i0;
+    std::vector<int> i1;
+    std::vector<int> nearest;
+    std::vector<int> w;
+    bool identity = false;      // One output per source sample, weights all 0
+
+    void build(int count, int offset, int size, float scale) {
+        i0.resize(count);
+        i1.resize(count);
+        nearest.resize(count);
+        w.resize(count);
+        identity = count == size;
+        for (int o = 0; o < count; ++o) {
+            float src = (o + 0.5f) / scale - 0.5f;
+            src = std::min(std::max(src, 0.0f), static_cast<float>(size - 1));
+            int s0 = static_cast<int>(src);
+            i0[o] = offset + s0;
+            i1[o] = offset + std::min(s0 + 1, size - 1);
+            nearest[o] = offset + std::min(static_cast<int>(src + 0.5f), size - 1);
+            w[o] = std::min(static_cast<int>(std::lround((src - s0) * WEIGHT_ONE)), WEIGHT_ONE);
+        }
+    }
+};
+
+YuvCoefficients coefficientsFor(VideoFrame::ColorMatrix matrix, bool fullRange) {
+    return matrix == VideoFrame::Bt709 ? PreprocessKernels::yuvCoefficients(0.2126f, 0.0722f, fullRange)
+                                       : PreprocessKernels::yuvCoefficients(0.299f, 0.114f, fullRange);
+}
+
+// Resamples one output row of a packed 8-bit image with `channels` per pixel.
+// Returns the source row itself when nothing needs interpolating.
+const uint8_t *resampleRow(const cv::Mat &image, int channels, const Axis &xs, int y0, int y1, int wy,
+                           int count, uint8_t *dst) {
+    const uint8_t *top = image.ptr<uint8_t>(y0);
+    if (xs.identity && wy == 0) {
+        return top + xs.i0[0] * channels;
+    }
+
+    const uint8_t *bottom = image.ptr<uint8_t>(y1);
+    for (int o = 0; o < count; ++o) {
+        int a = xs.i0[o] * channels;
+        int b = xs.i1[o] * channels;
+        int wx = xs.w[o];
+        for (int c = 0; c < channels; ++c) {
+            int t = top[a + c] * (WEIGHT_ONE - wx) + top[b + c] * wx;
+            int d = bottom[a + c] * (WEIGHT_ONE - wx) + bottom[b + c] * wx;
+            dst[o * channels + c] = static_cast<uint8_t>((t * (WEIGHT_ONE - wy) + d * wy + ROUND) >> (2 * WEIGHT_BITS));
+        }
+    }
+    return dst;
+}
+
+// 4:2:0 chroma is taken from its nearest sample, which at detector scale
+// makes no visible difference and halves the loads. planes: Y, U, V for
+// I420; Y, UV for NV12.
+void chromaRow(const cv::Mat *planes, bool nv12, const Axis &xs, int yNearest, int count,
+               uint8_t *u, uint8_t *v) {
+    int row = yNearest / 2;
+    const uint8_t *uRow = planes[1].ptr<uint8_t>(row);
+    const uint8_t *vRow = nv12 ? uRow + 1 : planes[2].ptr<uint8_t>(row);
+    int step = nv12 ? 2 : 1;
+    for (int o = 0; o < count; ++o) {
+        int c = (xs.nearest[o] / 2) * step;
+        u[o] = uRow[c];
+        v[o] = vRow[c];
+    }
+}
+
+} // namespace
+
+bool Preprocessor::toBlob(const VideoFrame &frame, const cv::Rect &roi, const cv::Size &inputSize,
+                          bool letterbox, cv::Mat &blob, Mapping *mapping) {
+    if (inputSize.area() <= 0) {
+        return false;
+    }
+
+    const int dims[] = { 1, 3, inputSize.height, inputSize.width };
+    blob.create(4, dims, CV_32F);
+    return toBlobAt(frame, roi, letterbox, blob, 0, mapping);
+}
+
+bool Preprocessor::toBlobAt(const VideoFrame &frame, const cv::Rect &roi, bool letterbox,
+                            cv::Mat &blob, int index, Mapping *mapping) {
+    if (frame.isNull() || roi.area() <= 0
+        || (roi & cv::Rect(0, 0, frame.width(), frame.height())) != roi) {
+        qDebug() << "Invalid preprocessing region";
+        return false;
+    }
+    if (blob.dims != 4 || blob.type() != CV_32F || blob.size[1] != 3
+        || index < 0 || index >= blob.size[0]) {
+        qDebug() << "Invalid blob for preprocessing";
+        return false;
+    }
+
+    // Stretch fills the input; letterbox keeps the aspect ratio and centres
+    // the region between grey borders
+    const int width = blob.size[3];
+    const int height = blob.size[2];
+    int contentWidth = width;
+    int contentHeight = height;
+    if (letterbox) {
+        float scale = std::min(static_cast<float>(width) / roi.width, static_cast<float>(height) / roi.height);
+        contentWidth = std::min(width, std::max(1, static_cast<int>(std::lround(roi.width * scale))));
+        contentHeight = std::min(height, std::max(1, static_cast<int>(std::lround(roi.height * scale))));
+    }
+    const int padX = (width - contentWidth) / 2;
+    const int padY = (height - contentHeight) / 2;
+    const float scaleX = static_cast<float>(contentWidth) / roi.width;
+    const float scaleY = static_cast<float>(contentHeight) / roi.height;
+
+    if (mapping) {
+        mapping->scaleX = scaleX;
+        mapping->scaleY = scaleY;
+        mapping->padX = static_cast<float>(padX);
+        mapping->padY = static_cast<float>(padY);
+    }
+
+    // Tables are per worker thread and only grow
+    thread_local Axis xs;
+    thread_local Axis ys;
+    xs.build(contentWidth, roi.x, roi.width, scaleX);
+    ys.build(contentHeight, roi.y, roi.height, scaleY);
+
+    const size_t planeSize = static_cast<size_t>(width) * height;
+    float *r = blob.ptr<float>(index);
+    float *g = r + planeSize;
+    float *b = g + planeSize;
+
+    const bool yuv = frame.format() != VideoFrame::BGR;
+    const bool nv12 = frame.format() == VideoFrame::NV12;
+    const YuvCoefficients k = coefficientsFor(frame.colorMatrix(), frame.fullRange());
+    cv::Mat planes[3];
+    for (int p = 0; p < frame.planeCount() && p < 3; ++p) {
+        planes[p] = frame.plane(p);
+    }
+
+    // Per worker thread 8-bit staging rows for resampled pixels
+    thread_local std::vector<uint8_t> staging;
+    staging.resize(static_cast<size_t>(contentWidth) * 3);
+    uint8_t *stage0 = staging.data();
+    uint8_t *stage1 = stage0 + contentWidth;
+    uint8_t *stage2 = stage1 + contentWidth;
+    const PreprocessKernels::Table &kernels = PreprocessKernels::active();
+
+    for (int oy = 0; oy < height; ++oy) {
+        float *rowR = r + oy * width;
+        float *rowG = g + oy * width;
+        float *rowB = b + oy * width;
+        int cy = oy - padY;
+        if (cy < 0 || cy >= contentHeight) {
+            for (float *plane : { rowR, rowG, rowB }) {
+                std::fill(plane, plane + width, LETTERBOX_FILL);
+            }
+            continue;
+        }
+        if (contentWidth < width) {
+            for (float *plane : { rowR, rowG, rowB }) {
+                std::fill(plane, plane + padX, LETTERBOX_FILL);
+                std::fill(plane + padX + contentWidth, plane + width, LETTERBOX_FILL);
+            }
+        }
+
+        if (yuv) {
+            const uint8_t *luma = resampleRow(planes[0], 1, xs, ys.i0[cy], ys.i1[cy], ys.w[cy], contentWidth, stage0);
+            chromaRow(planes, nv12, xs, ys.nearest[cy], contentWidth, stage1, stage2);
+            kernels.yuv(luma, stage1, stage2, contentWidth, k, rowR + padX, rowG + padX, rowB + padX);
+        } else {
+            // stage0 spans all three staging rows, enough for packed BGR
+            const uint8_t *bgr = resampleRow(planes[0], 3, xs, ys.i0[cy], ys.i1[cy], ys.w[cy], contentWidth, stage0);
+            kernels.bgr(bgr, contentWidth, rowR + padX, rowG + padX, rowB + padX);
+        }
+    }
+    return true;
+}
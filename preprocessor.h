@@ -0,0 +1,40 @@
+#ifndef PREPROCESSOR_H
+#define PREPROCESSOR_H
+
+#include <opencv2/opencv.hpp>
+#include "videoframe.h"
+
+// Frame to detector blob in a single pass: colour conversion (YUV or BGR to
+// RGB), bilinear resize of the region, optional letterbox and 1/255 scaling,
+// written straight into the 1x3xHxW float blob. Replaces videoconvert,
+// cvtColor, resize and blobFromImage, each of which walked every pixel.
+// Resampling is 8-bit fixed point like cv::resize; the float conversion of
+// each row runs in the SIMD kernels of PreprocessKernels.
+class Preprocessor
+{
+public:
+    static constexpr float LETTERBOX_FILL = 0.5f;   // Darknet's padding grey
+
+    // Network input pixels back to region pixels
+    struct Mapping {
+        float scaleX = 1.0f;     // Input pixels per region pixel
+        float scaleY = 1.0f;
+        float padX = 0.0f;       // Letterbox border, input pixels
+        float padY = 0.0f;
+
+        float toRegionX(float x) const { return (x - padX) / scaleX; }
+        float toRegionY(float y) const { return (y - padY) / scaleY; }
+    };
+
+    // roi is in frame pixels and must lie inside the frame. The blob is
+    // reallocated only when inputSize changes. Returns false for frames it
+    // cannot read.
+    static bool toBlob(const VideoFrame &frame, const cv::Rect &roi, const cv::Size &inputSize,
+                       bool letterbox, cv::Mat &blob, Mapping *mapping = nullptr);
+
+    // Same into image `index` of an existing Nx3xHxW batch blob
+    static bool toBlobAt(const VideoFrame &frame, const cv::Rect &roi, bool letterbox,
+                         cv::Mat &blob, int index, Mapping *mapping = nullptr);
+};
+
+#endif // PREPROCESSOR_H
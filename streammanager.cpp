@@ -0,0 +1,830 @@
+#include "streammanager.h"
+#include <QDebug>
+#include <algorithm>
+#include <utility>
+
+StreamManager::StreamManager(int workerCount, QObject *parent)
+    : QObject(parent) {
+
+    workerCount = qMax(1, workerCount);
+    m_threadsPerWorker = qMax(1, QThread::idealThreadCount() / workerCount);
+    ModelRegistry::find(ModelRegistry::DEFAULT_MODEL, m_model);
+    for (int i = 0; i < workerCount; ++i) {
+        Worker w;
+        w.worker = new DetectionWorker();
+        w.worker->setThreadBudget(m_threadsPerWorker);
+        w.thread = new QThread(this);
+        w.worker->moveToThread(w.thread);
+
+        // Results are delivered on the manager's thread, one per frame
+        connect(w.worker, &DetectionWorker::detectionDone, this, &StreamManager::handleWorkerResult);
+
+        w.thread->start();
+        m_workers.append(w);
+    }
+
+    // Networks load and warm up on the workers' threads, all at once, so
+    // neither the caller nor the first frames pay for it
+    m_loadClock.start();
+    m_workersLoading = m_workers.size();
+    for (int i = 0; i < m_workers.size(); ++i) {
+        QMetaObject::invokeMethod(m_workers.at(i).worker, [this, i, worker = m_workers.at(i).worker, info = m_model]() {
+            bool loaded = worker->loadModel(info);
+            workerLoaded(i, 0, loaded, worker->timings());
+        }, Qt::QueuedConnection);
+    }
+
+    // A partial batch goes out when its first frame has waited long enough
+    m_batchTimer.setSingleShot(true);
+    connect(&m_batchTimer, &QTimer::timeout, this, [this]() {
+        QMutexLocker locker(&m_mutex);
+        m_batchTimerArmed = false;
+        dispatch();
+    });
+
+    connect(&m_statsTimer, &QTimer::timeout, this, &StreamManager::updateStats);
+    m_statsTimer.start(STATS_INTERVAL_MS);
+    m_statsClock.start();
+
+    qDebug() << "Stream manager started with" << workerCount << "detection workers,"
+             << m_threadsPerWorker << "threads each";
+}
+
+StreamManager::~StreamManager() {
+    for (int streamId : streamIds()) {
+        removeStream(streamId);
+    }
+
+    // Let every worker finish its pass in parallel, and join them all
+    // before touching the list they share
+    for (const Worker &w : std::as_const(m_workers)) {
+        w.thread->quit();
+    }
+    for (const Worker &w : std::as_const(m_workers)) {
+        w.thread->wait();
+    }
+    for (const Worker &w : std::as_const(m_workers)) {
+        delete w.worker;
+    }
+    m_workers.clear();
+}
+
+int StreamManager::registerStream(const QString &url) {
+    QMutexLocker locker(&m_mutex);
+    int streamId = m_nextStreamId++;
+
+    Stream stream;
+    stream.url = url;
+    stream.externalRing = QSharedPointer<FrameRing>::create(MAX_PENDING_FRAMES, FrameRing::DropOldest);
+    stream.ring = stream.externalRing.data();
+    stream.externalDisplay = QSharedPointer<FrameRing>::create(DISPLAY_RING_FRAMES, FrameRing::DropOldest);
+    if (DEFAULT_MOTION_GATING) {
+        stream.motionGate = QSharedPointer<MotionGate>::create();
+    }
+    if (DEFAULT_TRACKING) {
+        stream.tracker = QSharedPointer<Tracker>::create();
+    }
+    stream.latency.setModel(m_model);
+    stream.stats.streamId = streamId;
+    stream.stats.url = url;
+    stream.added.start();
+    m_streams.insert(streamId, stream);
+    m_order.append(streamId);
+    return streamId;
+}
+
+int StreamManager::addStream(const QString &url) {
+    int streamId = registerStream(url);
+
+    auto rtsp = QSharedPointer<GStreamerRtsp>::create();
+    rtsp->setUrl(url);
+    rtsp->setDisplayMaxFps(DISPLAY_MAX_FPS);
+    rtsp->setDetectionRing(MAX_PENDING_FRAMES, FrameRing::DropOldest);
+    rtsp->setDisplayRing(DISPLAY_RING_FRAMES, FrameRing::DropOldest);
+    rtsp->setPullMode(m_pullMode);
+    rtsp->setRecording(m_recordingDir);
+
+    // Emitted on GStreamer streaming threads only when the consumer asked to
+    // be woken, so at most one queued event per ring is outstanding
+    connect(rtsp.data(), &GStreamerRtsp::detectionFrameReady, this,
+            [this]() {
+                QMutexLocker locker(&m_mutex);
+                dispatch();
+            }, Qt::QueuedConnection);
+    connect(rtsp.data(), &GStreamerRtsp::displayFrameReady, this,
+            [this, streamId]() {
+                emit displayFrameReady(streamId);
+            }, Qt::QueuedConnection);
+
+    {
+        QMutexLocker locker(&m_mutex);
+        Stream &stream = m_streams[streamId];
+        stream.rtsp = rtsp;
+        stream.ring = rtsp->detectionRing();
+        stream.externalRing.reset();
+        stream.externalDisplay.reset();
+    }
+
+    rtsp->start();
+    qDebug() << "Stream" << streamId << "added:" << url;
+    return streamId;
+}
+
+int StreamManager::addExternalStream(const QString &name) {
+    int streamId = registerStream(name);
+    qDebug() << "External stream" << streamId << "added:" << name;
+    return streamId;
+}
+
+void StreamManager::removeStream(int streamId) {
+    QSharedPointer<GStreamerRtsp> rtsp;
+    {
+        QMutexLocker locker(&m_mutex);
+        auto it = m_streams.find(streamId);
+        if (it == m_streams.end()) {
+            return;
+        }
+        rtsp = it->rtsp;
+        m_streams.erase(it);
+        m_order.removeAll(streamId);
+        if (m_rrCursor >= m_order.size()) {
+            m_rrCursor = 0;
+        }
+        auto ofStream = [streamId](const DetectionRequest &request) {
+            return request.streamId == streamId;
+        };
+        m_batch.erase(std::remove_if(m_batch.begin(), m_batch.end(), ofStream), m_batch.end());
+        for (Worker &worker : m_workers) {
+            for (QVector<DetectionRequest> &batch : worker.queue) {
+                batch.erase(std::remove_if(batch.begin(), batch.end(), ofStream), batch.end());
+            }
+            worker.queue.erase(std::remove_if(worker.queue.begin(), worker.queue.end(),
+                                              [](const QVector<DetectionRequest> &batch) {
+                                                  return batch.isEmpty();
+                                              }),
+                               worker.queue.end());
+        }
+    }
+
+    if (rtsp) {
+        disconnect(rtsp.data(), nullptr, this, nullptr);
+        rtsp->stop();
+        if (!rtsp->wait(1000)) {
+            rtsp->terminate();
+            rtsp->wait();
+        }
+    }
+
+    qDebug() << "Stream" << streamId << "removed";
+}
+
+QList<int> StreamManager::streamIds() const {
+    QMutexLocker locker(&m_mutex);
+    return m_order;
+}
+
+QSharedPointer<GStreamerRtsp> StreamManager::rtsp(int streamId) const {
+    QMutexLocker locker(&m_mutex);
+    auto it = m_streams.constFind(streamId);
+    return it != m_streams.constEnd() ? it->rtsp : QSharedPointer<GStreamerRtsp>();
+}
+
+StreamStats StreamManager::stats(int streamId) const {
+    QMutexLocker locker(&m_mutex);
+    auto it = m_streams.constFind(streamId);
+    if (it == m_streams.constEnd()) {
+        return StreamStats();
+    }
+
+    StreamStats stats = it->stats;
+    readRingCounters(*it, stats);
+    return stats;
+}
+
+void StreamManager::readRingCounters(const Stream &stream, StreamStats &stats) {
+    stats.framesReceived = stream.ring->pushed();
+    stats.framesDropped = stream.ring->overruns();
+    stats.displayDropped = stream.rtsp ? stream.rtsp->displayRing()->overruns() : stream.externalDisplay->overruns();
+    stats.framesSkipped = stats.framesDropped + stats.framesGated + stats.framesRateSkipped;
+}
+
+bool StreamManager::takeDisplayFrame(int streamId, VideoFrame &frame) {
+    // Hold the ring's owner so a concurrent removeStream cannot free it
+    QSharedPointer<GStreamerRtsp> rtsp;
+    QSharedPointer<FrameRing> external;
+    {
+        QMutexLocker locker(&m_mutex);
+        auto it = m_streams.constFind(streamId);
+        if (it == m_streams.constEnd()) {
+            return false;
+        }
+        rtsp = it->rtsp;
+        external = it->externalDisplay;
+    }
+
+    // Re-arm first so a frame pushed after the drain still wakes us
+    FrameRing *ring = rtsp ? rtsp->displayRing() : external.data();
+    if (!ring) {
+        return false;
+    }
+    ring->requestWakeup();
+    return ring->popLatest(frame);
+}
+
+int StreamManager::workerCount() const {
+    return m_workers.size();
+}
+
+int StreamManager::defaultWorkerCount() {
+    return qMax(1, QThread::idealThreadCount() / TARGET_THREADS_PER_WORKER);
+}
+
+int StreamManager::threadsPerWorker() const {
+    QMutexLocker locker(&m_mutex);
+    return m_threadsPerWorker;
+}
+
+quint64 StreamManager::stolenBatches() const {
+    QMutexLocker locker(&m_mutex);
+    return m_stolenBatches;
+}
+
+void StreamManager::setPullMode(bool enabled) {
+    m_pullMode = enabled;
+}
+
+void StreamManager::setBatching(int maxBatch, int deadlineMs) {
+    QMutexLocker locker(&m_mutex);
+    m_maxBatch = qMax(1, maxBatch);
+    m_batchDeadlineMs = qMax(0, deadlineMs);
+}
+
+void StreamManager::setMaxInFlight(int frames) {
+    QMutexLocker locker(&m_mutex);
+    m_maxInFlight = qMax(1, frames);
+}
+
+void StreamManager::setThreadsPerWorker(int threads) {
+    QMutexLocker locker(&m_mutex);
+    m_threadsPerWorker = threads > 0 ? threads : qMax(1, QThread::idealThreadCount() / m_workers.size());
+    for (Worker &w : m_workers) {
+        w.worker->setThreadBudget(m_threadsPerWorker);
+    }
+}
+
+bool StreamManager::setModel(const QString &name) {
+    ModelInfo info;
+    if (!ModelRegistry::find(name, info)) {
+        return false;
+    }
+    return setModel(info);
+}
+
+void StreamManager::setModel(const ModelInfo &info) {
+    QMutexLocker locker(&m_mutex);
+    int generation = ++m_loadGeneration;
+    m_loadClock.restart();
+    m_workersLoading = m_workers.size();
+    m_loadFailed = false;
+    m_modelTimings = ModelTimings();
+    m_modelReadyMs = -1;
+    m_model = info;
+    for (Stream &stream : m_streams) {
+        stream.latency.setModel(info);
+    }
+
+    // Workers reload between batches on their own threads, in parallel;
+    // dispatch passes them over until they report back
+    for (int i = 0; i < m_workers.size(); ++i) {
+        Worker &worker = m_workers[i];
+        worker.ready = false;
+        QMetaObject::invokeMethod(worker.worker, [this, i, generation, detector = worker.worker, info]() {
+            bool loaded = detector->loadModel(info);
+            workerLoaded(i, generation, loaded, detector->timings());
+        }, Qt::QueuedConnection);
+    }
+}
+
+ModelInfo StreamManager::model() const {
+    QMutexLocker locker(&m_mutex);
+    return m_model;
+}
+
+void StreamManager::workerLoaded(int workerIndex, int generation, bool loaded, const ModelTimings &timings) {
+    // Worker thread. A failed load is ready too: it keeps running the
+    // previous model, if any. A superseded load is followed by the current one.
+    bool finished = false;
+    bool ok = false;
+    {
+        QMutexLocker locker(&m_mutex);
+        if (generation != m_loadGeneration) {
+            return;
+        }
+        m_workers[workerIndex].ready = true;
+        m_loadFailed = m_loadFailed || !loaded;
+        m_modelTimings.readMs = qMax(m_modelTimings.readMs, timings.readMs);
+        m_modelTimings.warmupMs = qMax(m_modelTimings.warmupMs, timings.warmupMs);
+        m_modelTimings.firstPassMs = qMax(m_modelTimings.firstPassMs, timings.firstPassMs);
+        if (--m_workersLoading == 0) {
+            m_modelReadyMs = m_loadClock.elapsed();
+            finished = true;
+            ok = !m_loadFailed;
+            qDebug() << "Model ready on" << m_workers.size() << "workers after" << m_modelReadyMs << "ms";
+        }
+        dispatch();
+    }
+    if (finished) {
+        emit modelLoaded(ok);
+    }
+}
+
+ModelTimings StreamManager::modelTimings() const {
+    QMutexLocker locker(&m_mutex);
+    return m_modelTimings;
+}
+
+qint64 StreamManager::modelReadyMs() const {
+    QMutexLocker locker(&m_mutex);
+    return m_modelReadyMs;
+}
+
+void StreamManager::setLetterbox(bool enabled) {
+    // Any thread; the list is only read, so it never detaches
+    for (const Worker &w : std::as_const(m_workers)) {
+        w.worker->setLetterbox(enabled);
+    }
+}
+
+void StreamManager::setNms(Nms::Scope scope, bool soft) {
+    // Any thread; the list is only read, so it never detaches
+    for (const Worker &w : std::as_const(m_workers)) {
+        w.worker->setNms(scope, soft);
+    }
+}
+
+void StreamManager::setRecordingDir(const QString &dir) {
+    m_recordingDir = dir;
+}
+
+void StreamManager::setMotionGating(int streamId, bool enabled) {
+    QMutexLocker locker(&m_mutex);
+    auto it = m_streams.find(streamId);
+    if (it == m_streams.end()) {
+        return;
+    }
+
+    if (!enabled) {
+        it->motionGate.reset();
+    } else if (!it->motionGate) {
+        it->motionGate = QSharedPointer<MotionGate>::create();
+    }
+}
+
+void StreamManager::setLatencyBudget(int streamId, double ms) {
+    QMutexLocker locker(&m_mutex);
+    auto it = m_streams.find(streamId);
+    if (it != m_streams.end()) {
+        it->latency.setBudget(ms);
+    }
+}
+
+void StreamManager::setTiling(int streamId, int maxTiles) {
+    QMutexLocker locker(&m_mutex);
+    auto it = m_streams.find(streamId);
+    if (it != m_streams.end()) {
+        it->maxTiles = qMax(0, maxTiles);
+    }
+}
+
+void StreamManager::setTracking(int streamId, bool enabled) {
+    QMutexLocker locker(&m_mutex);
+    auto it = m_streams.find(streamId);
+    if (it == m_streams.end()) {
+        return;
+    }
+
+    if (!enabled) {
+        it->tracker.reset();
+    } else if (!it->tracker) {
+        it->tracker = QSharedPointer<Tracker>::create();
+    }
+}
+
+void StreamManager::setMaxDecodeLevel(int streamId, GStreamerRtsp::DecodeLevel level) {
+    QMutexLocker locker(&m_mutex);
+    auto it = m_streams.find(streamId);
+    if (it == m_streams.end()) {
+        return;
+    }
+
+    it->maxDecodeLevel = level;
+    if (it->rtsp && it->rtsp->decodeLevel() > level) {
+        it->rtsp->setDecodeLevel(level);
+    }
+}
+
+void StreamManager::submitFrame(int streamId, const VideoFrame &frame) {
+    if (frame.isNull()) {
+        return;
+    }
+
+    QSharedPointer<FrameRing> detection;
+    QSharedPointer<FrameRing> display;
+    {
+        QMutexLocker locker(&m_mutex);
+        auto it = m_streams.find(streamId);
+        if (it == m_streams.end()) {
+            return;
+        }
+        if (!it->externalRing) {
+            qWarning() << "Stream" << streamId << "is fed by its pipeline, frame ignored";
+            return;
+        }
+        detection = it->externalRing;
+        display = it->externalDisplay;
+    }
+
+    // Replaces a frame no worker has taken yet. Dispatch happens on the
+    // manager's thread, as for RTSP streams, never on the reader's.
+    if (detection->push(frame)) {
+        QMetaObject::invokeMethod(this, [this]() {
+            QMutexLocker locker(&m_mutex);
+            dispatch();
+        }, Qt::QueuedConnection);
+    }
+
+    // At most one display event is outstanding, however slow the painting
+    if (display->push(frame)) {
+        emit displayFrameReady(streamId);
+    }
+}
+
+void StreamManager::dispatch() {
+    // Caller holds m_mutex
+    for (;;) {
+        // An idle worker first, otherwise the least loaded one with queue room
+        int target = -1;
+        size_t targetLoad = 0;
+        for (int w = 0; w < m_workers.size(); ++w) {
+            const Worker &worker = m_workers[w];
+            size_t load = worker.queue.size() + (worker.busy ? 1 : 0);
+            if (worker.ready && worker.queue.size() < static_cast<size_t>(WORKER_QUEUE_DEPTH)
+                && (target == -1 || load < targetLoad)) {
+                target = w;
+                targetLoad = load;
+            }
+        }
+        if (target == -1) {
+            return;
+        }
+
+        collectBatch();
+        if (m_batch.isEmpty()) {
+            return;
+        }
+
+        // Hold a partial batch until its deadline, unless no other frame
+        // could still join it
+        int reachable = qMin(m_maxBatch, m_order.size() * m_maxInFlight);
+        qint64 waitedMs = (VideoFrame::nowNs() - m_batchStartNs) / 1000000;
+        if (m_batch.size() < reachable && waitedMs < m_batchDeadlineMs) {
+            armBatchTimer(static_cast<int>(m_batchDeadlineMs - waitedMs));
+            return;
+        }
+
+        for (const DetectionRequest &request : m_batch) {
+            request.frame.stamp(FrameTiming::Dispatched);
+        }
+        Worker &worker = m_workers[target];
+        worker.queue.push_back(m_batch);
+        m_batch.clear();
+        if (!worker.busy) {
+            worker.busy = true;
+            QMetaObject::invokeMethod(worker.worker, [this, target, detector = worker.worker]() {
+                runWorker(target, detector);
+            }, Qt::QueuedConnection);
+        }
+    }
+}
+
+void StreamManager::collectBatch() {
+    // Caller holds m_mutex. Round-robin passes, one frame per stream each,
+    // until the batch is full or no stream can give more.
+    int count = m_order.size();
+    bool progress = true;
+    while (progress && m_batch.size() < m_maxBatch) {
+        progress = false;
+        int first = m_rrCursor;
+        for (int step = 0; step < count && m_batch.size() < m_maxBatch; ++step) {
+            int index = (first + step) % count;
+            Stream &stream = m_streams[m_order[index]];
+            if (stream.inFlight >= m_maxInFlight) {
+                continue;
+            }
+
+            // Ask for a wake-up before looking, then the next push either
+            // lands here or triggers another dispatch
+            VideoFrame frame;
+            stream.ring->requestWakeup();
+            if (!stream.ring->pop(frame)) {
+                continue;
+            }
+            progress = true;
+
+            int streamId = m_order[index];
+
+            // Frames between the controller's detections reuse the last ones
+            if (!stream.latency.shouldDetect() && stream.hasLastResult) {
+                stream.stats.framesRateSkipped++;
+                reuseLastResult(streamId, stream, frame);
+                continue;
+            }
+            const cv::Size inputSize = stream.latency.inputSize();
+
+            stream.inFlight++;
+            m_rrCursor = (index + 1) % count;
+            if (m_batch.isEmpty()) {
+                m_batchStartNs = VideoFrame::nowNs();
+            }
+
+            DetectionRequest request;
+            request.streamId = streamId;
+            request.frame = frame;
+            request.inputSize = inputSize;
+            request.motionGate = stream.motionGate;
+            request.reusable = stream.hasLastResult;
+            request.maxTiles = stream.maxTiles;
+            request.tileRound = stream.maxTiles > 0 ? stream.tileRounds++ : 0;
+            request.sequence = stream.nextSequence++;
+            m_batch.append(request);
+        }
+    }
+}
+
+void StreamManager::armBatchTimer(int ms) {
+    // Caller holds m_mutex; dispatch() runs on any thread, the timer lives
+    // on the manager's
+    if (m_batchTimerArmed) {
+        return;
+    }
+    m_batchTimerArmed = true;
+    QMetaObject::invokeMethod(&m_batchTimer, "start", Qt::QueuedConnection, Q_ARG(int, qMax(0, ms)));
+}
+
+void StreamManager::runWorker(int workerIndex, DetectionWorker *worker) {
+    // Worker thread: its own queue first, then other workers' queues.
+    // m_workers is only touched under the lock, in takeWork.
+    QVector<DetectionRequest> batch;
+    while (takeWork(workerIndex, batch)) {
+        worker->detectBatch(batch);
+    }
+}
+
+bool StreamManager::takeWork(int workerIndex, QVector<DetectionRequest> &batch) {
+    QMutexLocker locker(&m_mutex);
+    Worker &own = m_workers[workerIndex];
+    if (!own.queue.empty()) {
+        batch = std::move(own.queue.front());
+        own.queue.pop_front();
+        return true;
+    }
+
+    // Steal the oldest waiting batch of the most loaded worker
+    int victim = -1;
+    size_t most = 0;
+    for (int w = 0; w < m_workers.size(); ++w) {
+        if (w != workerIndex && m_workers[w].queue.size() > most) {
+            victim = w;
+            most = m_workers[w].queue.size();
+        }
+    }
+    if (victim != -1) {
+        batch = std::move(m_workers[victim].queue.front());
+        m_workers[victim].queue.pop_front();
+        ++m_stolenBatches;
+        return true;
+    }
+
+    // Idle now; frames may have waited for a free worker
+    own.busy = false;
+    dispatch();
+    return false;
+}
+
+void StreamManager::reuseLastResult(int streamId, Stream &stream, const VideoFrame &frame) {
+    // Caller holds m_mutex. Takes its turn behind older frames still being
+    // inferred and picks up their detections when released.
+    DetectionResult result;
+    result.streamId = streamId;
+    result.reused = true;
+    result.sequence = stream.nextSequence++;
+    result.timing = frame.timing();
+    result.timing.stamps[FrameTiming::InferenceStart] = VideoFrame::nowNs();
+    result.timing.stamps[FrameTiming::InferenceEnd] = result.timing.at(FrameTiming::InferenceStart);
+    stream.reorder.insert(result.sequence, result);
+    releaseResults(stream);
+
+    // Emitted on the manager's thread, after the lock is gone
+    if (!m_outbox.isEmpty() && !m_flushQueued) {
+        m_flushQueued = true;
+        QMetaObject::invokeMethod(this, [this]() {
+            flushResults();
+        }, Qt::QueuedConnection);
+    }
+}
+
+void StreamManager::releaseResults(Stream &stream) {
+    // Caller holds m_mutex
+    while (!stream.reorder.isEmpty() && stream.reorder.firstKey() == stream.nextDelivery) {
+        DetectionResult result = stream.reorder.take(stream.nextDelivery++);
+        int fresh = 0;
+
+        if (result.reused) {
+            DetectionResult reused = stream.lastResult;
+            reused.reused = true;
+            reused.processingTime = 0.0;
+            reused.sequence = result.sequence;
+            reused.timing = result.timing;
+            result = reused;
+        } else if (result.detected) {
+            stream.stats.framesDetected++;
+            if (result.tiles == 0) {
+                stream.stats.batchSizeTotal += result.batchSize;
+                stream.stats.framesBatched++;
+            }
+            stream.stats.inferenceSecondsTotal += result.processingTime;
+            stream.stats.tilesInferred += result.tiles;
+            if (stream.stats.timeToFirstDetectionMs < 0) {
+                stream.stats.timeToFirstDetectionMs = stream.added.elapsed();
+                stream.stats.firstInferenceMs = result.processingTime * result.batchSize * 1000.0;
+            }
+
+            // A crop only refreshes its own area; keep earlier detections
+            // centred outside it. A tracker gets this frame's boxes only and
+            // predicts the rest itself.
+            fresh = static_cast<int>(result.detections.size());
+            DetectionResult merged = result;
+            if (stream.hasLastResult && result.region.area() < 1.0f) {
+                for (const Detection &detection : stream.lastResult.detections) {
+                    cv::Point2f centre(detection.box.x + detection.box.width / 2,
+                                       detection.box.y + detection.box.height / 2);
+                    if (!result.region.contains(centre)) {
+                        merged.detections.push_back(detection);
+                    }
+                }
+            }
+            stream.lastResult = merged;
+            stream.hasLastResult = true;
+            if (!stream.tracker) {
+                result = merged;
+            }
+        }
+
+        Outgoing outgoing;
+        outgoing.result = result;
+        outgoing.fresh = fresh;
+        outgoing.tracker = stream.tracker;
+        outgoing.rtsp = stream.rtsp;
+        m_outbox.append(outgoing);
+    }
+}
+
+void StreamManager::flushResults() {
+    // Manager's thread only, so each tracker sees its stream's results one
+    // at a time and in order
+    QList<Outgoing> results;
+    {
+        QMutexLocker locker(&m_mutex);
+        results.swap(m_outbox);
+        m_flushQueued = false;
+    }
+
+    // One outbox keeps every stream's results in release order
+    for (Outgoing &outgoing : results) {
+        DetectionResult &result = outgoing.result;
+
+        // Tracks carry the boxes over frames the detector did not see; time
+        // is the frame's capture, so jittery delivery does not move them
+        int fresh = outgoing.fresh;
+        if (outgoing.tracker && (result.detected || result.reused)) {
+            FrameTiming::Stage first = result.timing.firstStage();
+            qint64 capturedNs = first < FrameTiming::StageCount ? result.timing.at(first) : VideoFrame::nowNs();
+            if (result.detected && !result.reused) {
+                fresh = outgoing.tracker->update(result.detections, capturedNs / 1e9, result.region);
+            } else {
+                outgoing.tracker->predict(capturedNs / 1e9, result.detections);
+            }
+        }
+
+        // Only objects the detector just saw start or extend a clip; reused
+        // and predicted boxes would keep one open on a parked car or a
+        // coasting track
+        if (outgoing.rtsp && fresh > 0) {
+            outgoing.rtsp->triggerRecording();
+        }
+        emit detectionDone(result.streamId, result);
+    }
+}
+
+void StreamManager::handleWorkerResult(int streamId, const DetectionResult &result) {
+    {
+        QMutexLocker locker(&m_mutex);
+        auto it = m_streams.find(streamId);
+        if (it != m_streams.end()) {
+            it->inFlight = qMax(0, it->inFlight - 1);
+            if (result.sequence != it->nextDelivery) {
+                it->stats.resultsReordered++;
+            }
+            if (result.detected) {
+                it->latency.addSample(result.inputSize, 1000.0 * result.processingTime * result.batchSize);
+            }
+            if (result.gated) {
+                it->gateFrames++;
+                it->gateSaved += result.inferenceSaved;
+                it->stats.framesGateEvaluated++;
+                it->stats.inferencesSavedTotal += result.inferenceSaved;
+                if (result.reused) {
+                    it->stats.framesGated++;
+                }
+            }
+            it->reorder.insert(result.sequence, result);
+            releaseResults(*it);
+        }
+        // Late results of removed streams are dropped
+
+        dispatch();
+    }
+
+    flushResults();
+}
+
+void StreamManager::updateStats() {
+    double elapsed = m_statsClock.restart() / 1000.0;
+    if (elapsed <= 0.0) {
+        return;
+    }
+
+    QList<StreamStats> all;
+    {
+        QMutexLocker locker(&m_mutex);
+        for (int streamId : m_order) {
+            Stream &stream = m_streams[streamId];
+            readRingCounters(stream, stream.stats);
+            quint64 received = stream.stats.framesReceived - stream.lastReceived;
+            quint64 dropped = stream.stats.framesDropped - stream.lastDropped;
+            stream.stats.inputFps = received / elapsed;
+            quint64 detected = stream.stats.framesDetected - stream.lastDetected;
+            stream.stats.detectionFps = detected / elapsed;
+            quint64 batched = stream.stats.framesBatched - stream.lastBatched;
+            stream.stats.avgBatchSize = batched ? static_cast<double>(stream.stats.batchSizeTotal - stream.lastBatchTotal) / batched : 0.0;
+            stream.stats.inferenceMs = detected ? 1000.0 * (stream.stats.inferenceSecondsTotal - stream.lastInferenceTotal) / detected : 0.0;
+            stream.lastBatchTotal = stream.stats.batchSizeTotal;
+            stream.lastBatched = stream.stats.framesBatched;
+            stream.lastInferenceTotal = stream.stats.inferenceSecondsTotal;
+            stream.lastReceived = stream.stats.framesReceived;
+            stream.lastDetected = stream.stats.framesDetected;
+            stream.lastDropped = stream.stats.framesDropped;
+            stream.stats.inferenceSaved = stream.gateFrames > 0 ? stream.gateSaved / stream.gateFrames : 0.0;
+            stream.gateSaved = 0.0;
+            stream.gateFrames = 0;
+            stream.stats.inputSize = stream.latency.inputSize();
+            stream.stats.detectStride = stream.latency.stride();
+
+            if (stream.rtsp) {
+                adjustDecodeLevel(stream, received > 0 ? static_cast<double>(dropped) / received : 0.0);
+                stream.stats.decodeLevel = stream.rtsp->decodeLevel();
+                stream.stats.decoderSkipped = stream.rtsp->decoderSkippedFrames();
+                stream.stats.clipsRecorded = stream.rtsp->recordedClips();
+                stream.stats.reconnectCount = stream.rtsp->reconnectCount();
+                stream.stats.lastRecoveryMs = stream.rtsp->lastRecoveryMs();
+                stream.stats.timeToFirstFrameMs = stream.rtsp->timeToFirstFrameMs();
+            }
+            all.append(stream.stats);
+        }
+    }
+
+    emit statsUpdated(all);
+}
+
+void StreamManager::adjustDecodeLevel(Stream &stream, double dropRatio) {
+    // Frames we would drop anyway should not be decoded. Escalate quickly
+    // when inference falls behind, relax slowly to avoid oscillating.
+    int level = stream.rtsp->decodeLevel();
+
+    if (dropRatio > DECODE_ESCALATE_DROP_RATIO) {
+        stream.calmIntervals = 0;
+        if (++stream.busyIntervals >= DECODE_ESCALATE_INTERVALS && level < stream.maxDecodeLevel) {
+            stream.rtsp->setDecodeLevel(static_cast<GStreamerRtsp::DecodeLevel>(level + 1));
+            stream.busyIntervals = 0;
+        }
+    } else if (dropRatio < DECODE_RELAX_DROP_RATIO) {
+        stream.busyIntervals = 0;
+        if (++stream.calmIntervals >= DECODE_RELAX_INTERVALS && level > GStreamerRtsp::DecodeAll) {
+            stream.rtsp->setDecodeLevel(static_cast<GStreamerRtsp::DecodeLevel>(level - 1));
+            stream.calmIntervals = 0;
+        }
+    } else {
+        stream.busyIntervals = 0;
+        stream.calmIntervals = 0;
+    }
+}
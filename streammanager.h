@@ -0,0 +1,287 @@
+#ifndef STREAMMANAGER_H
+#define STREAMMANAGER_H
+
+#include <QObject>
+#include <QMap>
+#include <QList>
+#include <QVector>
+#include <QMutex>
+#include <QThread>
+#include <QTimer>
+#include <QSharedPointer>
+#include <QElapsedTimer>
+#include <deque>
+#include "gstreamerrtsp.h"
+#include "detectionworker.h"
+#include "videoframe.h"
+#include "framering.h"
+#include "motiongate.h"
+#include "latencycontroller.h"
+#include "tracker.h"
+#include "detectionresult.h"
+
+struct StreamStats {
+    int streamId = -1;
+    QString url;
+    double inputFps = 0.0;
+    double detectionFps = 0.0;
+    quint64 framesReceived = 0;
+    quint64 framesDetected = 0;
+    quint64 framesSkipped = 0;      // Not inferred for any reason: dropped + gated + rate skipped
+    quint64 framesDropped = 0;      // Superseded in the detection mailbox before a worker was free
+    quint64 displayDropped = 0;     // Superseded in the display mailbox before it was painted
+    quint64 framesGated = 0;        // Skipped by the motion gate, last detections reused
+    quint64 framesRateSkipped = 0;  // Skipped by the latency controller, last detections reused
+    cv::Size inputSize;             // Network input the latency controller picked; empty for the model's
+    int detectStride = LatencyController::DEFAULT_STRIDE;   // Every n'th frame is detected
+    double inferenceSaved = 0.0;    // Share of inference the motion gate avoided, last interval
+    double inferencesSavedTotal = 0.0;  // Cumulative, in full-frame inferences
+    quint64 framesGateEvaluated = 0;
+    double avgBatchSize = 0.0;          // Frames per forward pass, last interval, tiled frames excluded
+    double inferenceMs = 0.0;           // Amortized per detected frame, last interval
+    quint64 batchSizeTotal = 0;         // Cumulative, summed over batched frames
+    quint64 framesBatched = 0;          // Detected frames except tiled ones, whose passes are their own
+    double inferenceSecondsTotal = 0.0; // Cumulative, amortized
+    quint64 resultsReordered = 0;       // Finished before an older frame and held back
+    quint64 tilesInferred = 0;          // Cumulative, besides the coarse passes
+    qint64 timeToFirstDetectionMs = -1; // Stream added to its first detected frame, model start-up included
+    double firstInferenceMs = -1.0;     // That frame's forward pass, after the warm-up
+    int decodeLevel = GStreamerRtsp::DecodeAll;
+    quint64 decoderSkipped = 0;         // Cumulative; flat at DecodeReferenceOnly means that level is a no-op here
+    int reconnectCount = 0;
+    qint64 lastRecoveryMs = -1;
+    qint64 timeToFirstFrameMs = -1;
+    int clipsRecorded = 0;
+};
+
+// Owns any number of sources and feeds them into a fixed pool of detection
+// workers, each with its own network. Each stream feeds one-slot FrameRing
+// mailboxes for detection and display, so a new frame replaces the one
+// still waiting: memory stays constant and a consumer that falls behind
+// always gets the newest frame. Frames are taken in round-robin order so no
+// camera can starve the others, queued on the least loaded worker, and
+// stolen by workers that run dry. Results leave in each stream's frame order.
+class StreamManager : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit StreamManager(int workerCount = DEFAULT_WORKER_COUNT, QObject *parent = nullptr);
+    ~StreamManager() override;
+
+    static constexpr int DEFAULT_WORKER_COUNT = 2;   // Inference slots
+    static constexpr int MAX_PENDING_FRAMES = 1;     // Detection mailbox per stream, newest frame wins
+    static constexpr int DISPLAY_RING_FRAMES = 1;
+    static constexpr int STATS_INTERVAL_MS = 1000;
+    static constexpr int DISPLAY_MAX_FPS = 0;        // 0 keeps the camera rate
+    static constexpr bool DEFAULT_PULL_MODE = false; // Appsink puller threads instead of callbacks
+    static constexpr bool DEFAULT_MOTION_GATING = true;
+    static constexpr bool DEFAULT_TRACKING = true;
+    static constexpr int DEFAULT_MAX_BATCH = 1;          // Frames per forward pass; 1 disables batching
+    static constexpr int DEFAULT_BATCH_DEADLINE_MS = 5;  // Longest a frame waits for a fuller batch
+    static constexpr int DEFAULT_MAX_IN_FLIGHT = 1;      // Frames per stream being inferred at once
+    static constexpr int WORKER_QUEUE_DEPTH = 1;         // Batches queued behind a worker's running one
+    static constexpr int TARGET_THREADS_PER_WORKER = 4;  // A small net stops scaling much beyond this
+
+    // Load-driven decode skipping: drop ratios measured per stats interval
+    static constexpr double DECODE_ESCALATE_DROP_RATIO = 0.5;
+    static constexpr double DECODE_RELAX_DROP_RATIO = 0.1;
+    static constexpr int DECODE_ESCALATE_INTERVALS = 2;
+    static constexpr int DECODE_RELAX_INTERVALS = 5;
+    static constexpr GStreamerRtsp::DecodeLevel DEFAULT_MAX_DECODE_LEVEL = GStreamerRtsp::DecodeReferenceOnly;
+
+    int addStream(const QString &url);
+    int addExternalStream(const QString &name);
+    void removeStream(int streamId);
+
+    QList<int> streamIds() const;
+    QSharedPointer<GStreamerRtsp> rtsp(int streamId) const;
+    StreamStats stats(int streamId) const;
+    int workerCount() const;
+    int threadsPerWorker() const;
+    static int defaultWorkerCount();   // Cores / TARGET_THREADS_PER_WORKER
+    quint64 stolenBatches() const;
+
+    // Starts loading a registry model into every worker and returns at once;
+    // each worker reloads after its current batch and gets no frames until
+    // it is done. modelLoaded reports the outcome. False when the name is
+    // unknown.
+    bool setModel(const QString &name);
+    void setModel(const ModelInfo &info);   // A registry entry with e.g. its precision changed
+    ModelInfo model() const;
+
+    // Start-up of the current model: the slowest worker's read and warm-up,
+    // and the milliseconds from construction (or setModel) until every
+    // worker was ready, -1 while any is still loading. The constructor
+    // loads the default model on the workers' threads, in parallel.
+    ModelTimings modelTimings() const;
+    qint64 modelReadyMs() const;
+
+    // Newest display frame of a stream, after displayFrameReady. Call from
+    // one thread only; it is the display mailboxes' consumer.
+    bool takeDisplayFrame(int streamId, VideoFrame &frame);
+
+    // Applies to streams added afterwards
+    void setPullMode(bool enabled);
+
+    // Hand workers up to maxBatch frames from different streams at once,
+    // holding the first one at most deadlineMs while the batch fills
+    void setBatching(int maxBatch, int deadlineMs = DEFAULT_BATCH_DEADLINE_MS);
+
+    // Frames of one stream that may be inferred concurrently. Above 1,
+    // several workers can share a busy stream; results are reordered.
+    void setMaxInFlight(int frames);
+
+    // OpenCV threads per network; 0 splits the cores evenly over the workers
+    void setThreadsPerWorker(int threads);
+
+    // Letterbox detector inputs instead of stretching them
+    void setLetterbox(bool enabled);
+
+    // Per-class or class-agnostic NMS, optionally Soft-NMS
+    void setNms(Nms::Scope scope, bool soft = false);
+
+    // Detection-triggered passthrough clips for streams added afterwards;
+    // an empty directory disables recording
+    void setRecordingDir(const QString &dir);
+
+    // Skip or crop inference for static scenes
+    void setMotionGating(int streamId, bool enabled);
+
+    // Track boxes across frames: detections get stable ids, and frames
+    // without inference get predicted boxes instead of the last ones
+    void setTracking(int streamId, bool enabled);
+
+    // Longest a detection pass of this stream should take. Picks the input
+    // size (for reshapable models) and the detection rate from measured pass
+    // times; 0 restores the model's size at the default rate.
+    void setLatencyBudget(int streamId, double ms);
+
+    // Tiled inference for frames much larger than the network input: a
+    // coarse full-frame pass plus up to maxTiles native-scale tiles per
+    // frame, merged with NMS. 0 disables it.
+    void setTiling(int streamId, int maxTiles);
+
+    // Highest decode level the load controller may fall back to (DecodeAll
+    // disables it). Skipped frames are not displayed either, so a detection
+    // backlog also lowers the display rate; DecodeKeyframesOnly freezes the
+    // picture between keyframes. The default, DecodeReferenceOnly, drops
+    // nothing on streams without non-reference frames, see decoderSkipped.
+    void setMaxDecodeLevel(int streamId, GStreamerRtsp::DecodeLevel level);
+
+public slots:
+    // Frames of external streams; RTSP streams feed their mailboxes directly.
+    // Thread-safe, so a reader can call it on its own thread: it only
+    // publishes the frame, replacing any still waiting for a worker or the
+    // display, and wakes the manager, which dispatches on its own thread.
+    // displayFrameReady is only emitted when the display slot was drained.
+    void submitFrame(int streamId, const VideoFrame &frame);
+
+signals:
+    void displayFrameReady(int streamId);
+    void detectionDone(int streamId, const DetectionResult &result);
+    void statsUpdated(const QList<StreamStats> &stats);
+    // Every worker finished loading the current model; ok is false when any
+    // failed and kept its previous model
+    void modelLoaded(bool ok);
+
+private slots:
+    void updateStats();
+
+private:
+    struct Stream {
+        QString url;
+        QSharedPointer<GStreamerRtsp> rtsp;
+        FrameRing *ring = nullptr;               // The RTSP detection ring, or externalRing
+        QSharedPointer<FrameRing> externalRing;
+        QSharedPointer<FrameRing> externalDisplay;   // Null for RTSP streams
+        int inFlight = 0;                        // Batched, queued or running
+        quint64 nextSequence = 0;                // Of the next frame taken from the ring
+        quint64 nextDelivery = 0;                // Results leave in sequence order
+        QMap<quint64, DetectionResult> reorder;  // Done, waiting for older frames
+        QSharedPointer<MotionGate> motionGate;   // Null when gating is off
+        QSharedPointer<Tracker> tracker;         // Null when tracking is off
+        LatencyController latency;
+        int maxTiles = 0;
+        quint64 tileRounds = 0;
+        QElapsedTimer added;
+        DetectionResult lastResult;
+        bool hasLastResult = false;
+        double gateSaved = 0.0;                  // Summed over the stats interval
+        quint64 gateFrames = 0;
+        StreamStats stats;
+        quint64 lastReceived = 0;
+        quint64 lastDetected = 0;
+        quint64 lastDropped = 0;
+        quint64 lastBatchTotal = 0;
+        quint64 lastBatched = 0;
+        double lastInferenceTotal = 0.0;
+        GStreamerRtsp::DecodeLevel maxDecodeLevel = DEFAULT_MAX_DECODE_LEVEL;
+        int busyIntervals = 0;
+        int calmIntervals = 0;
+    };
+
+    // A released result and the per-stream work still due on it, which
+    // runs in flushResults on the manager's thread, outside the lock
+    struct Outgoing {
+        DetectionResult result;
+        int fresh = 0;                     // Boxes inferred for this very frame
+        QSharedPointer<Tracker> tracker;
+        QSharedPointer<GStreamerRtsp> rtsp;
+    };
+
+    struct Worker {
+        DetectionWorker *worker = nullptr;
+        QThread *thread = nullptr;
+        std::deque<QVector<DetectionRequest>> queue;   // Not started yet, may be stolen
+        bool busy = false;                             // Draining its queue
+        bool ready = false;                            // Loaded and warmed up; gets no work before
+    };
+
+    int registerStream(const QString &url);
+    void workerLoaded(int workerIndex, int generation, bool loaded, const ModelTimings &timings);
+    void handleWorkerResult(int streamId, const DetectionResult &result);
+    void dispatch();
+    void collectBatch();
+    void armBatchTimer(int ms);
+    void runWorker(int workerIndex, DetectionWorker *worker);
+    bool takeWork(int workerIndex, QVector<DetectionRequest> &batch);
+    void reuseLastResult(int streamId, Stream &stream, const VideoFrame &frame);
+    void releaseResults(Stream &stream);
+    void flushResults();
+    static void readRingCounters(const Stream &stream, StreamStats &stats);
+    void adjustDecodeLevel(Stream &stream, double dropRatio);
+
+    mutable QMutex m_mutex;
+    QMap<int, Stream> m_streams;
+    QList<int> m_order;          // Round-robin order of stream ids
+    int m_rrCursor = 0;
+    int m_nextStreamId = 0;
+    bool m_pullMode = DEFAULT_PULL_MODE;
+    QString m_recordingDir;
+    QList<Worker> m_workers;
+    ModelInfo m_model;
+    QElapsedTimer m_loadClock;           // Since the current model's load started
+    int m_loadGeneration = 0;            // Counts model loads; stale reports are ignored
+    int m_workersLoading = 0;
+    bool m_loadFailed = false;           // In any worker, this generation
+    ModelTimings m_modelTimings;
+    qint64 m_modelReadyMs = -1;
+
+    int m_maxBatch = DEFAULT_MAX_BATCH;
+    int m_batchDeadlineMs = DEFAULT_BATCH_DEADLINE_MS;
+    QVector<DetectionRequest> m_batch;   // Collected, not yet handed to a worker
+    qint64 m_batchStartNs = 0;
+    QTimer m_batchTimer;
+    bool m_batchTimerArmed = false;
+    int m_maxInFlight = DEFAULT_MAX_IN_FLIGHT;
+    int m_threadsPerWorker = 1;
+    quint64 m_stolenBatches = 0;
+    QList<Outgoing> m_outbox;            // Released in order, not yet emitted
+    bool m_flushQueued = false;
+
+    QTimer m_statsTimer;
+    QElapsedTimer m_statsClock;
+};
+
+#endif // STREAMMANAGER_H
@@ -0,0 +1,142 @@
+// Runs every preprocessing kernel this CPU supports against the scalar
+// reference: all widths up to a few vectors past the widest one, odd input
+// widths, misaligned rows, and guard floats after each plane so a tail that
+// writes too far fails too. Exits non-zero on any difference.
+#include <QCoreApplication>
+#include <QTextStream>
+#include <cstring>
+#include <vector>
+#include "preprocesskernels.h"
+
+namespace {
+
+constexpr int MAX_VECTOR_WIDTH = 16;   // Pixels per AVX-512 iteration, the widest
+constexpr int GUARD = 16;              // Floats after each plane that must stay untouched
+constexpr float SENTINEL = -1.0f;
+const int EXTRA_WIDTHS[] = { 319, 415, 416, 417, 607, 639, 641, 1279, 1921 };
+
+// Deterministic, so a failure reproduces
+class Bytes
+{
+public:
+    void fill(std::vector<uint8_t> &bytes) {
+        for (uint8_t &b : bytes) {
+            m_state ^= m_state << 13;
+            m_state ^= m_state >> 17;
+            m_state ^= m_state << 5;
+            b = static_cast<uint8_t>(m_state >> 24);
+        }
+    }
+
+private:
+    uint32_t m_state = 0x9e3779b9u;
+};
+
+// Three planes of count floats, each followed by GUARD sentinels, starting
+// offset floats into the buffer
+struct Planes {
+    Planes(int count, int offset)
+        : count(count), stride(count + GUARD), data(offset + 3 * (count + GUARD), SENTINEL), first(offset) {}
+
+    float *plane(int p) { return data.data() + first + p * stride; }
+    bool operator==(const Planes &other) const {
+        return std::memcmp(data.data(), other.data.data(), data.size() * sizeof(float)) == 0;
+    }
+
+    int count;
+    int stride;
+    std::vector<float> data;
+    int first;
+};
+
+bool checkWidth(const PreprocessKernels::Table &reference, const PreprocessKernels::Table &table,
+                int width, Bytes &random, QString &failure) {
+    const YuvCoefficients coefficients[] = {
+        PreprocessKernels::yuvCoefficients(0.299f, 0.114f, false),
+        PreprocessKernels::yuvCoefficients(0.2126f, 0.0722f, true),
+    };
+
+    // Source rows start 0..3 bytes past an allocation, planes 0..1 floats
+    for (int offset = 0; offset < 4; ++offset) {
+        std::vector<uint8_t> bgr(offset + 3 * static_cast<size_t>(width));
+        std::vector<uint8_t> y(offset + width), u(offset + width), v(offset + width);
+        random.fill(bgr);
+        random.fill(y);
+        random.fill(u);
+        random.fill(v);
+
+        Planes expected(width, offset % 2);
+        Planes actual(width, offset % 2);
+        reference.bgr(bgr.data() + offset, width, expected.plane(0), expected.plane(1), expected.plane(2));
+        table.bgr(bgr.data() + offset, width, actual.plane(0), actual.plane(1), actual.plane(2));
+        if (!(expected == actual)) {
+            failure = QString("bgr width %1, offset %2").arg(width).arg(offset);
+            return false;
+        }
+
+        for (const YuvCoefficients &k : coefficients) {
+            Planes expected(width, offset % 2);
+            Planes actual(width, offset % 2);
+            reference.yuv(y.data() + offset, u.data() + offset, v.data() + offset, width, k,
+                          expected.plane(0), expected.plane(1), expected.plane(2));
+            table.yuv(y.data() + offset, u.data() + offset, v.data() + offset, width, k,
+                      actual.plane(0), actual.plane(1), actual.plane(2));
+            if (!(expected == actual)) {
+                failure = QString("yuv width %1, offset %2").arg(width).arg(offset);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    QTextStream out(stdout);
+
+    std::vector<int> widths;
+    for (int width = 1; width <= 4 * MAX_VECTOR_WIDTH + 1; ++width) {
+        widths.push_back(width);
+    }
+    widths.insert(widths.end(), std::begin(EXTRA_WIDTHS), std::end(EXTRA_WIDTHS));
+
+    const PreprocessKernels::Table reference = PreprocessKernels::forIsa(PreprocessKernels::Scalar);
+    Bytes random;
+    bool ok = true;
+    for (PreprocessKernels::Isa isa : { PreprocessKernels::Avx2, PreprocessKernels::Avx512, PreprocessKernels::Neon }) {
+        if (!PreprocessKernels::available(isa)) {
+            out << PreprocessKernels::name(isa) << ": not supported, skipped\n";
+            continue;
+        }
+
+        const PreprocessKernels::Table table = PreprocessKernels::forIsa(isa);
+        QString failure;
+        int checked = 0;
+        for (int width : widths) {
+            if (!checkWidth(reference, table, width, random, failure)) {
+                break;
+            }
+            ++checked;
+        }
+        if (failure.isEmpty()) {
+            out << PreprocessKernels::name(isa) << ": " << checked << " widths bit-exact\n";
+        } else {
+            out << PreprocessKernels::name(isa) << ": MISMATCH at " << failure << "\n";
+            ok = false;
+        }
+    }
+
+    // And the library's own self-check, as the benchmark runs it
+    QStringList report;
+    if (!PreprocessKernels::verify(&report)) {
+        ok = false;
+    }
+    for (const QString &line : report) {
+        out << "verify " << line << "\n";
+    }
+
+    out << (ok ? "PASS" : "FAIL") << "\n";
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,23 @@
+# Checks the SIMD preprocessing kernels against their scalar reference.
+# `make check` builds and runs it; it exits non-zero on any mismatch.
+QT       = core
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+# Same flags as the app, or the reference itself would round differently
+gcc|clang: QMAKE_CXXFLAGS += -ffp-contract=off
+TARGET = kernelcheck
+INCLUDEPATH += $$PWD/..
+
+SOURCES += \
+    kernelcheck.cpp \
+    ../cpufeatures.cpp \
+    ../preprocesskernels.cpp
+
+HEADERS += \
+    ../cpufeatures.h \
+    ../preprocesskernels.h
+
+check.commands = $$shell_path($$OUT_PWD/$$TARGET)
+check.depends = $(TARGET)
+QMAKE_EXTRA_TARGETS += check
@@ -0,0 +1,78 @@
+#include "tiling.h"
+#include <algorithm>
+#include <cmath>
+
+bool Tiling::worthTiling(const cv::Size &area, const cv::Size &tile) {
+    return tile.area() > 0
+           && (area.width >= tile.width * MIN_UPSCALE || area.height >= tile.height * MIN_UPSCALE);
+}
+
+std::vector<cv::Rect> Tiling::grid(const cv::Rect &area, const cv::Size &tile) {
+    // Start offsets along one side; a side shorter than the tile gets one
+    // clipped tile
+    auto starts = [](int length, int side) {
+        std::vector<int> offsets;
+        if (length <= side) {
+            offsets.push_back(0);
+            return offsets;
+        }
+        int step = std::max(1, static_cast<int>(side * (1.0f - OVERLAP)));
+        int count = static_cast<int>(std::ceil(static_cast<double>(length - side) / step)) + 1;
+        for (int i = 0; i < count; ++i) {
+            offsets.push_back(std::min(i * step, length - side));
+        }
+        return offsets;
+    };
+
+    std::vector<cv::Rect> tiles;
+    for (int y : starts(area.height, tile.height)) {
+        for (int x : starts(area.width, tile.width)) {
+            tiles.push_back(cv::Rect(area.x + x, area.y + y, tile.width, tile.height) & area);
+        }
+    }
+    return tiles;
+}
+
+std::vector<int> Tiling::select(const std::vector<cv::Rect> &tiles, const DetectionCandidates &hints,
+                                int begin, int end, int maxTiles, quint64 round) {
+    const int count = static_cast<int>(tiles.size());
+    std::vector<float> weight(count, 0.0f);
+    for (int i = begin; i < end; ++i) {
+        float width = hints.width[i];
+        float height = hints.height[i];
+        cv::Point2f centre(hints.left[i] + width / 2, hints.top[i] + height / 2);
+        for (int t = 0; t < count; ++t) {
+            const cv::Rect &tile = tiles[t];
+            if (width <= tile.width * HINT_MAX_SIDE && height <= tile.height * HINT_MAX_SIDE
+                && tile.contains(cv::Point(static_cast<int>(centre.x), static_cast<int>(centre.y)))) {
+                weight[t] += hints.score[i];
+            }
+        }
+    }
+
+    std::vector<int> hinted;
+    for (int t = 0; t < count; ++t) {
+        if (weight[t] > 0.0f) {
+            hinted.push_back(t);
+        }
+    }
+    std::stable_sort(hinted.begin(), hinted.end(), [&](int a, int b) { return weight[a] > weight[b]; });
+
+    std::vector<int> chosen(hinted.begin(), hinted.begin() + std::min<int>(maxTiles, static_cast<int>(hinted.size())));
+    const int start = count > 0 ? static_cast<int>(round * maxTiles % count) : 0;
+    for (int i = 0; i < count && static_cast<int>(chosen.size()) < maxTiles; ++i) {
+        int t = (start + i) % count;
+        if (weight[t] <= 0.0f) {
+            chosen.push_back(t);
+        }
+    }
+    return chosen;
+}
+
+bool Tiling::cutBySeam(const cv::Rect &tile, const cv::Rect &area,
+                       float left, float top, float width, float height) {
+    return (tile.x > area.x && left <= tile.x + SEAM_MARGIN)
+           || (tile.y > area.y && top <= tile.y + SEAM_MARGIN)
+           || (tile.br().x < area.br().x && left + width >= tile.br().x - SEAM_MARGIN)
+           || (tile.br().y < area.br().y && top + height >= tile.br().y - SEAM_MARGIN);
+}
@@ -0,0 +1,44 @@
+#ifndef TILING_H
+#define TILING_H
+
+#include <QtGlobal>
+#include <opencv2/core.hpp>
+#include <vector>
+#include "yolodecoder.h"
+
+// Tiled inference for frames much larger than the network input. The area
+// is covered by overlapping tiles at native scale, one network input each.
+// A coarse pass over the whole area finds the large objects and hints at
+// small ones: hinted tiles run first, and the rest of a fixed per-frame
+// budget visits the other tiles round-robin, so a frame costs at most
+// 1 + maxTiles inputs and every tile is revisited within a few frames.
+class Tiling
+{
+public:
+    static constexpr float OVERLAP = 0.25f;               // Of a tile side; smaller objects cross a seam whole
+    static constexpr float HINT_THRESHOLD_SCALE = 0.25f;  // Coarse candidates above this share of the threshold are hints
+    static constexpr float HINT_MAX_SIDE = 0.5f;          // Of a tile side; larger boxes are the coarse pass's own
+    static constexpr float MIN_UPSCALE = 1.5f;            // Only areas at least this much larger than a tile
+    static constexpr int SEAM_MARGIN = 2;                 // Pixels
+
+    static bool worthTiling(const cv::Size &area, const cv::Size &tile);
+
+    // Overlapping tiles covering area, row-major; the last row and column
+    // are moved inwards so every tile is full size
+    static std::vector<cv::Rect> grid(const cv::Rect &area, const cv::Size &tile);
+
+    // Up to maxTiles indices into tiles. Candidates [begin, end) of hints
+    // are coarse boxes in frame pixels; tiles holding small ones come first,
+    // by summed score, then the others from a position that moves by
+    // maxTiles each round.
+    static std::vector<int> select(const std::vector<cv::Rect> &tiles, const DetectionCandidates &hints,
+                                   int begin, int end, int maxTiles, quint64 round);
+
+    // Whether a box (frame pixels) found in tile touches a side of it that
+    // lies inside area: the object was probably cut there, and the tile
+    // across the seam or the coarse pass has it whole
+    static bool cutBySeam(const cv::Rect &tile, const cv::Rect &area,
+                          float left, float top, float width, float height);
+};
+
+#endif // TILING_H
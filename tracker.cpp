@@ -0,0 +1,188 @@
+#include "tracker.h"
+#include <algorithm>
+
+namespace {
+
+// IoU penalised by the centre distance relative to the enclosing box: 1
+// for identical boxes, towards -1 for distant ones
+float distanceIou(const cv::Rect2f &a, const cv::Rect2f &b) {
+    float inter = (a & b).area();
+    float unionArea = a.area() + b.area() - inter;
+    float iou = unionArea > 0.0f ? inter / unionArea : 0.0f;
+
+    float dx = (a.x + a.width / 2) - (b.x + b.width / 2);
+    float dy = (a.y + a.height / 2) - (b.y + b.height / 2);
+    float cw = std::max(a.x + a.width, b.x + b.width) - std::min(a.x, b.x);
+    float ch = std::max(a.y + a.height, b.y + b.height) - std::min(a.y, b.y);
+    float diagonal = cw * cw + ch * ch;
+    return diagonal > 0.0f ? iou - (dx * dx + dy * dy) / diagonal : iou;
+}
+
+} // namespace
+
+void Tracker::Axis::predict(float dt, float accelerationStd) {
+    // x' = F x, P' = F P F^T + Q with F = [1 dt; 0 1] and white acceleration
+    float q = accelerationStd * accelerationStd;
+    float dt2 = dt * dt;
+    position += velocity * dt;
+    p00 += dt * (2.0f * p01 + dt * p11) + q * dt2 * dt2 / 4.0f;
+    p01 += dt * p11 + q * dt2 * dt / 2.0f;
+    p11 += q * dt2;
+}
+
+void Tracker::Axis::correct(float measured, float measurementStd) {
+    float s = p00 + measurementStd * measurementStd;
+    float k0 = p00 / s;
+    float k1 = p01 / s;
+    float residual = measured - position;
+    position += k0 * residual;
+    velocity += k1 * residual;
+    p11 -= k1 * p01;
+    p01 -= k0 * p01;
+    p00 -= k0 * p00;
+}
+
+cv::Rect2f Tracker::Track::boxAt(double seconds) const {
+    float dt = static_cast<float>(std::min(std::max(seconds - time, 0.0), MAX_PREDICTION));
+    float cx = axes[CentreX].position + axes[CentreX].velocity * dt;
+    float cy = axes[CentreY].position + axes[CentreY].velocity * dt;
+    float w = std::max(axes[Width].position + axes[Width].velocity * dt, 1e-4f);
+    float h = std::max(axes[Height].position + axes[Height].velocity * dt, 1e-4f);
+    return cv::Rect2f(cx - w / 2, cy - h / 2, w, h);
+}
+
+Detection Tracker::toDetection(const Track &track, const cv::Rect2f &box) {
+    Detection detection;
+    detection.classId = track.classId;
+    detection.label = track.label;
+    detection.confidence = track.confidence;
+    detection.trackId = track.id;
+    detection.box = box;
+    return detection;
+}
+
+int Tracker::update(std::vector<Detection> &detections, double seconds, const cv::Rect2f &region) {
+    // Bring every track to this run's time
+    std::vector<cv::Rect2f> predicted(m_tracks.size());
+    for (size_t t = 0; t < m_tracks.size(); ++t) {
+        Track &track = m_tracks[t];
+        float dt = static_cast<float>(std::min(std::max(seconds - track.time, 0.0), MAX_PREDICTION));
+        float scale = track.axes[Height].position;
+        for (Axis &axis : track.axes) {
+            axis.predict(dt, ACCELERATION_NOISE * scale);
+        }
+        track.time = seconds;
+        predicted[t] = track.boxAt(seconds);
+    }
+
+    // Greedy association, most similar first
+    struct Pair {
+        float similarity;
+        int track;
+        int detection;
+    };
+    // Only tracks the run could have seen take part
+    const bool wholeFrame = region.area() >= 1.0f;
+    std::vector<bool> observed(m_tracks.size(), true);
+    for (size_t t = 0; t < m_tracks.size() && !wholeFrame; ++t) {
+        const cv::Rect2f &box = predicted[t];
+        observed[t] = region.contains(cv::Point2f(box.x + box.width / 2, box.y + box.height / 2));
+    }
+
+    std::vector<Pair> pairs;
+    for (size_t t = 0; t < m_tracks.size(); ++t) {
+        if (!observed[t]) {
+            continue;
+        }
+        for (size_t d = 0; d < detections.size(); ++d) {
+            if (detections[d].classId != m_tracks[t].classId) {
+                continue;
+            }
+            float similarity = distanceIou(predicted[t], detections[d].box);
+            if (similarity >= MIN_SIMILARITY) {
+                pairs.push_back({ similarity, static_cast<int>(t), static_cast<int>(d) });
+            }
+        }
+    }
+    std::sort(pairs.begin(), pairs.end(), [](const Pair &a, const Pair &b) { return a.similarity > b.similarity; });
+
+    std::vector<int> trackOf(detections.size(), -1);
+    std::vector<bool> matched(m_tracks.size(), false);
+    for (const Pair &pair : pairs) {
+        if (matched[pair.track] || trackOf[pair.detection] >= 0) {
+            continue;
+        }
+        matched[pair.track] = true;
+        trackOf[pair.detection] = pair.track;
+    }
+
+    for (size_t d = 0; d < detections.size(); ++d) {
+        const Detection &detection = detections[d];
+        const cv::Rect2f &box = detection.box;
+        const float measured[AxisCount] = { box.x + box.width / 2, box.y + box.height / 2, box.width, box.height };
+        const float measurementStd = MEASUREMENT_NOISE * box.height;
+
+        if (trackOf[d] >= 0) {
+            Track &track = m_tracks[trackOf[d]];
+            for (int a = 0; a < AxisCount; ++a) {
+                track.axes[a].correct(measured[a], measurementStd);
+            }
+            track.confidence = detection.confidence;
+            track.label = detection.label;
+            track.hits++;
+            track.misses = 0;
+            continue;
+        }
+
+        Track track;
+        track.id = m_nextId++;
+        track.classId = detection.classId;
+        track.label = detection.label;
+        track.confidence = detection.confidence;
+        track.time = seconds;
+        track.hits = 1;
+        const float velocityStd = INITIAL_VELOCITY * box.height;
+        for (int a = 0; a < AxisCount; ++a) {
+            track.axes[a].position = measured[a];
+            track.axes[a].p00 = measurementStd * measurementStd;
+            track.axes[a].p11 = velocityStd * velocityStd;
+        }
+        m_tracks.push_back(track);
+        matched.push_back(true);
+        observed.push_back(true);
+    }
+
+    // Unconfirmed tracks go at their first miss, confirmed ones coast a while
+    size_t kept = 0;
+    int measured = 0;
+    for (size_t t = 0; t < m_tracks.size(); ++t) {
+        Track &track = m_tracks[t];
+        if (observed[t] && !matched[t]) {
+            track.misses++;
+        }
+        if (track.visible() && track.misses <= MAX_MISSES) {
+            m_tracks[kept++] = track;
+            measured += matched[t] ? 1 : 0;
+        }
+    }
+    m_tracks.resize(kept);
+
+    detections.clear();
+    for (const Track &track : m_tracks) {
+        detections.push_back(toDetection(track, track.boxAt(seconds)));
+    }
+    return measured;
+}
+
+void Tracker::predict(double seconds, std::vector<Detection> &out) const {
+    out.clear();
+    for (const Track &track : m_tracks) {
+        if (track.visible()) {
+            out.push_back(toDetection(track, track.boxAt(seconds)));
+        }
+    }
+}
+
+void Tracker::reset() {
+    m_tracks.clear();
+}
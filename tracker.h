@@ -0,0 +1,75 @@
+#ifndef TRACKER_H
+#define TRACKER_H
+
+#include <string>
+#include <vector>
+#include "detectionresult.h"
+
+// Carries boxes across the frames the detector does not see. Detections are
+// associated with tracks of their class greedily by distance-IoU (IoU minus
+// the squared centre distance over the enclosing box's diagonal), so a fast
+// object that no longer overlaps its prediction still matches. Each track
+// runs a constant-velocity Kalman filter per box coordinate (centre and
+// size), so frames between detector runs get predicted boxes and every
+// object keeps a stable id. Coordinates are normalised to the frame, time
+// is in seconds.
+class Tracker
+{
+public:
+    static constexpr float MIN_SIMILARITY = -0.2f;      // Distance-IoU; about a 1.4 box-width jump
+    static constexpr int MIN_HITS = 2;                  // Matches before a track outlives a missed detection
+    static constexpr int MAX_MISSES = 3;                // Detector runs a confirmed track may go unmatched
+    static constexpr double MAX_PREDICTION = 1.0;       // Seconds extrapolated past the last match
+    static constexpr float MEASUREMENT_NOISE = 0.05f;   // Std of a detected coordinate, in box heights
+    static constexpr float ACCELERATION_NOISE = 1.0f;   // Std, in box heights per second squared
+    static constexpr float INITIAL_VELOCITY = 1.0f;     // Std of a new track's speed, in box heights per second
+
+    // Corrects the tracks with a detector run at time seconds over region
+    // (normalised; a crop, or the whole frame). Tracks centred outside it
+    // were not looked for: they are predicted, not counted as missed.
+    // detections is replaced by all tracked boxes, with their ids. Returns
+    // how many of them this run measured, new tracks included; the rest coast.
+    int update(std::vector<Detection> &detections, double seconds,
+               const cv::Rect2f &region = cv::Rect2f(0.0f, 0.0f, 1.0f, 1.0f));
+
+    // Tracked boxes at time seconds, between detector runs
+    void predict(double seconds, std::vector<Detection> &out) const;
+
+    void reset();
+
+private:
+    // Position and velocity along one coordinate, with their covariance
+    struct Axis {
+        float position = 0.0f;
+        float velocity = 0.0f;
+        float p00 = 0.0f;
+        float p01 = 0.0f;
+        float p11 = 0.0f;
+
+        void predict(float dt, float accelerationStd);
+        void correct(float measured, float measurementStd);
+    };
+
+    enum { CentreX = 0, CentreY, Width, Height, AxisCount };
+
+    struct Track {
+        int id = 0;
+        int classId = -1;
+        std::string label;
+        float confidence = 0.0f;
+        Axis axes[AxisCount];
+        double time = 0.0;      // Of the filter state
+        int hits = 0;
+        int misses = 0;
+
+        bool visible() const { return misses == 0 || hits >= MIN_HITS; }
+        cv::Rect2f boxAt(double seconds) const;
+    };
+
+    static Detection toDetection(const Track &track, const cv::Rect2f &box);
+
+    std::vector<Track> m_tracks;
+    int m_nextId = 1;
+};
+
+#endif // TRACKER_H
@@ -0,0 +1,243 @@
+#include "videoframe.h"
+#include <QDebug>
+#include <gst/video/video.h>
+
+static std::atomic<quint64> s_totalBytesCopied{0};
+
+struct VideoFrame::Data {
+    Data() {
+        for (auto &stamp : stamps) {
+            stamp.store(0, std::memory_order_relaxed);
+        }
+        stamps[FrameTiming::Sampled].store(VideoFrame::nowNs(), std::memory_order_relaxed);
+    }
+
+    ~Data() {
+        if (mapped) {
+            gst_video_frame_unmap(&videoFrame);
+        }
+        if (sample) {
+            gst_sample_unref(sample);
+        }
+    }
+
+    GstSample *sample = nullptr;
+    GstVideoFrame videoFrame;
+    bool mapped = false;
+    VideoFrame::PixelFormat format = VideoFrame::BGR;
+    VideoFrame::ColorMatrix matrix = VideoFrame::Bt601;
+    bool fullRange = false;
+    int width = 0;
+    int height = 0;
+    size_t size = 0;
+    cv::Mat planes[3];
+    int planeCount = 0;
+    std::atomic<qint64> ptsNs{-1};
+    std::atomic<qint64> stamps[FrameTiming::StageCount];
+    std::atomic<quint64> bytesCopied{0};
+};
+
+VideoFrame VideoFrame::fromSample(GstSample *sample) {
+    VideoFrame frame;
+    if (!sample) {
+        return frame;
+    }
+
+    GstCaps *caps = gst_sample_get_caps(sample);
+    GstBuffer *buffer = gst_sample_get_buffer(sample);
+    if (!caps || !buffer) {
+        qDebug() << "Sample has no caps or buffer";
+        return frame;
+    }
+
+    GstVideoInfo info;
+    if (!gst_video_info_from_caps(&info, caps)) {
+        qDebug() << "Failed to parse video info from caps";
+        return frame;
+    }
+
+    PixelFormat format;
+    switch (GST_VIDEO_INFO_FORMAT(&info)) {
+    case GST_VIDEO_FORMAT_BGR:
+        format = BGR;
+        break;
+    case GST_VIDEO_FORMAT_I420:
+        format = I420;
+        break;
+    case GST_VIDEO_FORMAT_NV12:
+        format = NV12;
+        break;
+    default:
+        qDebug() << "Unsupported frame format:" << GST_VIDEO_INFO_NAME(&info);
+        return frame;
+    }
+
+    auto data = std::make_shared<Data>();
+    if (!gst_video_frame_map(&data->videoFrame, &info, buffer, GST_MAP_READ)) {
+        qDebug() << "Failed to map buffer";
+        return frame;
+    }
+    data->mapped = true;
+    data->sample = gst_sample_ref(sample);
+    data->format = format;
+    data->matrix = GST_VIDEO_INFO_COLORIMETRY(&info).matrix == GST_VIDEO_COLOR_MATRIX_BT709 ? Bt709 : Bt601;
+    data->fullRange = GST_VIDEO_INFO_COLORIMETRY(&info).range == GST_VIDEO_COLOR_RANGE_0_255;
+    data->width = GST_VIDEO_INFO_WIDTH(&info);
+    data->height = GST_VIDEO_INFO_HEIGHT(&info);
+    data->size = GST_VIDEO_INFO_SIZE(&info);
+
+    // Wrap the mapped planes, honouring the row strides GStreamer chose.
+    // For these formats plane p starts with component p, so the component
+    // size is the plane size (NV12's UV plane holds both chroma samples).
+    data->planeCount = static_cast<int>(GST_VIDEO_FRAME_N_PLANES(&data->videoFrame));
+    for (int p = 0; p < data->planeCount; ++p) {
+        int type = CV_8UC1;
+        if (format == BGR) {
+            type = CV_8UC3;
+        } else if (format == NV12 && p == 1) {
+            type = CV_8UC2;
+        }
+        data->planes[p] = cv::Mat(GST_VIDEO_FRAME_COMP_HEIGHT(&data->videoFrame, p),
+                                  GST_VIDEO_FRAME_COMP_WIDTH(&data->videoFrame, p),
+                                  type,
+                                  GST_VIDEO_FRAME_PLANE_DATA(&data->videoFrame, p),
+                                  GST_VIDEO_FRAME_PLANE_STRIDE(&data->videoFrame, p));
+    }
+
+    frame.d = std::move(data);
+    return frame;
+}
+
+VideoFrame VideoFrame::fromMat(const cv::Mat &mat) {
+    VideoFrame frame;
+    if (mat.empty() || mat.type() != CV_8UC3) {
+        return frame;
+    }
+
+    frame.d = std::make_shared<Data>();
+    frame.d->width = mat.cols;
+    frame.d->height = mat.rows;
+    frame.d->size = mat.total() * mat.elemSize();
+    frame.d->planes[0] = mat;
+    frame.d->planeCount = 1;
+    return frame;
+}
+
+bool VideoFrame::isNull() const {
+    return !d || d->planeCount == 0;
+}
+
+int VideoFrame::width() const {
+    return d ? d->width : 0;
+}
+
+int VideoFrame::height() const {
+    return d ? d->height : 0;
+}
+
+size_t VideoFrame::sizeInBytes() const {
+    return d ? d->size : 0;
+}
+
+VideoFrame::PixelFormat VideoFrame::format() const {
+    return d ? d->format : BGR;
+}
+
+VideoFrame::ColorMatrix VideoFrame::colorMatrix() const {
+    return d ? d->matrix : Bt601;
+}
+
+bool VideoFrame::fullRange() const {
+    return d && d->fullRange;
+}
+
+cv::Mat VideoFrame::mat() const {
+    return d && d->format == BGR ? d->planes[0] : cv::Mat();
+}
+
+int VideoFrame::planeCount() const {
+    return d ? d->planeCount : 0;
+}
+
+cv::Mat VideoFrame::plane(int index) const {
+    return d && index >= 0 && index < d->planeCount ? d->planes[index] : cv::Mat();
+}
+
+cv::Mat VideoFrame::analysisView() const {
+    return plane(0);
+}
+
+static void releaseFrameData(void *info) {
+    delete static_cast<std::shared_ptr<void>*>(info);
+}
+
+QImage VideoFrame::image() const {
+    cv::Mat bgr = mat();
+    if (bgr.empty()) {
+        return QImage();
+    }
+
+    // The image holds its own reference so it can outlive this handle
+    return QImage(static_cast<const uchar*>(bgr.data),
+                  bgr.cols,
+                  bgr.rows,
+                  static_cast<int>(bgr.step),
+                  QImage::Format_BGR888,
+                  releaseFrameData,
+                  new std::shared_ptr<void>(d));
+}
+
+cv::Mat VideoFrame::copyMat() const {
+    cv::Mat bgr = mat();
+    if (bgr.empty()) {
+        return cv::Mat();
+    }
+
+    recordCopy(sizeInBytes());
+    return bgr.clone();
+}
+
+void VideoFrame::recordCopy(size_t bytes) const {
+    if (d) {
+        d->bytesCopied.fetch_add(bytes, std::memory_order_relaxed);
+    }
+    s_totalBytesCopied.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+quint64 VideoFrame::bytesCopied() const {
+    return d ? d->bytesCopied.load(std::memory_order_relaxed) : 0;
+}
+
+quint64 VideoFrame::totalBytesCopied() {
+    return s_totalBytesCopied.load(std::memory_order_relaxed);
+}
+
+FrameTiming VideoFrame::timing() const {
+    FrameTiming timing;
+    if (!d) {
+        return timing;
+    }
+
+    timing.ptsNs = d->ptsNs.load(std::memory_order_relaxed);
+    for (int s = 0; s < FrameTiming::StageCount; ++s) {
+        timing.stamps[s] = d->stamps[s].load(std::memory_order_relaxed);
+    }
+    return timing;
+}
+
+void VideoFrame::stamp(FrameTiming::Stage stage, qint64 ns) const {
+    if (d && stage < FrameTiming::StageCount) {
+        d->stamps[stage].store(ns, std::memory_order_relaxed);
+    }
+}
+
+void VideoFrame::setPts(qint64 ptsNs) const {
+    if (d) {
+        d->ptsNs.store(ptsNs, std::memory_order_relaxed);
+    }
+}
+
+qint64 VideoFrame::nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
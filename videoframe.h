@@ -0,0 +1,83 @@
+#ifndef VIDEOFRAME_H
+#define VIDEOFRAME_H
+
+#include <QImage>
+#include <QMetaType>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <gst/gst.h>
+#include <opencv2/opencv.hpp>
+#include "frametiming.h"
+
+// Refcounted handle to a decoded frame. A frame built from a GstSample keeps
+// the sample referenced and its buffer mapped; the buffer goes back to
+// GStreamer when the last VideoFrame or QImage view is dropped. cv::Mat views
+// hold no reference: keep a VideoFrame alive for as long as any of them.
+// Frames are packed BGR or the decoder's native planar I420/NV12.
+class VideoFrame
+{
+public:
+    enum PixelFormat {
+        BGR = 0,
+        I420,       // Y, U, V planes, chroma halved both ways
+        NV12        // Y plane, interleaved UV plane
+    };
+
+    enum ColorMatrix {
+        Bt601 = 0,
+        Bt709
+    };
+
+    VideoFrame() = default;
+
+    static VideoFrame fromSample(GstSample *sample);
+    static VideoFrame fromMat(const cv::Mat &mat);
+
+    bool isNull() const;
+    int width() const;
+    int height() const;
+    size_t sizeInBytes() const;
+
+    // YUV layout, only meaningful for I420/NV12
+    PixelFormat format() const;
+    ColorMatrix colorMatrix() const;
+    bool fullRange() const;
+
+    // Read-only views, no pixel copy. Writing through them is not allowed.
+    // mat() and image() are BGR only and empty for YUV frames. The image
+    // keeps the frame's data alive; Mats from here and plane() or
+    // analysisView() do not, and must not outlive the frame (copyMat() does).
+    cv::Mat mat() const;
+    QImage image() const;
+
+    // Plane views: BGR has one, I420 Y/U/V, NV12 Y/UV (CV_8UC2)
+    int planeCount() const;
+    cv::Mat plane(int index) const;
+
+    // Grayscale or BGR view for cheap analysis: the Y plane of YUV frames
+    cv::Mat analysisView() const;
+
+    // Deep copy of mat(), accounted in bytesCopied()
+    cv::Mat copyMat() const;
+    void recordCopy(size_t bytes) const;
+
+    quint64 bytesCopied() const;
+    static quint64 totalBytesCopied();
+
+    // Per-stage timestamps. Sampled is set on creation; later stages are
+    // stamped by whoever handles the frame, from any thread.
+    FrameTiming timing() const;
+    void stamp(FrameTiming::Stage stage, qint64 ns = nowNs()) const;
+    void setPts(qint64 ptsNs) const;
+
+    static qint64 nowNs();   // Steady clock, shared by every stamp
+
+private:
+    struct Data;
+    std::shared_ptr<Data> d;
+};
+
+Q_DECLARE_METATYPE(VideoFrame)
+
+#endif // VIDEOFRAME_H
@@ -18,13 +18,16 @@ void VideoReader::startReading(const QString &filePath) {
         return;
     }
 
-    cv::Mat frame;
-    while (videoCapture.read(frame) && !m_stop) {
-        // Convert OpenCV Mat to QImage
-        QImage qImage(frame.data, frame.cols, frame.rows, frame.step, QImage::Format_BGR888);
-
-        // Emit the frame to the main thread
-        emit frameReady(qImage);
+    while (!m_stop) {
+        // Decode into a fresh Mat each time; consumers may still hold the previous one
+        cv::Mat frame;
+        if (!videoCapture.read(frame)) {
+            break;
+        }
+
+        // Hand the frame on without copying the pixels; receivers connect
+        // directly and must not block the reader
+        emit frameReady(VideoFrame::fromMat(frame));
 
         // Add a delay to control the frame rate (e.g., 30 FPS)
         QThread::msleep(33); // 1000 ms / 30 FPS ≈ 33 ms per frame
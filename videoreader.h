@@ -7,6 +7,7 @@
 #include <QImage>
 #include <atomic>
 #include <opencv2/opencv.hpp>
+#include "videoframe.h"
 
 class VideoReader : public QObject
 {
@@ -21,7 +22,7 @@ public slots:
     void stopReading();
 
 signals:
-    void frameReady(const QImage &frame);
+    void frameReady(const VideoFrame &frame);
     void finished();
 
 private:
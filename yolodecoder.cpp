@@ -0,0 +1,265 @@
+#include "yolodecoder.h"
+#include "cpufeatures.h"
+#include <QtGlobal>
+#include <algorithm>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define DECODER_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(__aarch64__) || defined(_M_ARM64)
+#define DECODER_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+using MaxScoreFn = float (*)(const float *, int);
+using MaxIntoFn = void (*)(float *, const float *, int);
+
+float maxScoreScalar(const float *scores, int count) {
+    float best = 0.0f;
+    for (int i = 0; i < count; ++i) {
+        best = std::max(best, scores[i]);
+    }
+    return best;
+}
+
+void maxIntoScalar(float *best, const float *row, int count) {
+    for (int i = 0; i < count; ++i) {
+        best[i] = std::max(best[i], row[i]);
+    }
+}
+
+#ifdef DECODER_X86
+
+CPU_TARGET("avx2")
+void maxIntoAvx2(float *best, const float *row, int count) {
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        _mm256_storeu_ps(best + i, _mm256_max_ps(_mm256_loadu_ps(row + i), _mm256_loadu_ps(best + i)));
+    }
+    maxIntoScalar(best + i, row + i, count - i);
+}
+
+CPU_TARGET("avx512f")
+void maxIntoAvx512(float *best, const float *row, int count) {
+    int i = 0;
+    for (; i + 16 <= count; i += 16) {
+        _mm512_storeu_ps(best + i, _mm512_max_ps(_mm512_loadu_ps(row + i), _mm512_loadu_ps(best + i)));
+    }
+    maxIntoScalar(best + i, row + i, count - i);
+}
+
+CPU_TARGET("avx2")
+float maxScoreAvx2(const float *scores, int count) {
+    __m256 best = _mm256_setzero_ps();
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        best = _mm256_max_ps(best, _mm256_loadu_ps(scores + i));
+    }
+    __m128 half = _mm_max_ps(_mm256_castps256_ps128(best), _mm256_extractf128_ps(best, 1));
+    half = _mm_max_ps(half, _mm_movehl_ps(half, half));
+    half = _mm_max_ss(half, _mm_shuffle_ps(half, half, 1));
+    float result = _mm_cvtss_f32(half);
+    for (; i < count; ++i) {
+        result = std::max(result, scores[i]);
+    }
+    return result;
+}
+
+CPU_TARGET("avx512f")
+float maxScoreAvx512(const float *scores, int count) {
+    __m512 best = _mm512_setzero_ps();
+    int i = 0;
+    for (; i + 16 <= count; i += 16) {
+        best = _mm512_max_ps(best, _mm512_loadu_ps(scores + i));
+    }
+    // The tail is a masked load; inactive lanes keep the running max
+    if (i < count) {
+        __mmask16 tail = static_cast<__mmask16>((1u << (count - i)) - 1u);
+        best = _mm512_mask_max_ps(best, tail, best, _mm512_maskz_loadu_ps(tail, scores + i));
+    }
+    return _mm512_reduce_max_ps(best);
+}
+
+#endif // DECODER_X86
+
+#ifdef DECODER_NEON
+
+void maxIntoNeon(float *best, const float *row, int count) {
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        vst1q_f32(best + i, vmaxq_f32(vld1q_f32(row + i), vld1q_f32(best + i)));
+    }
+    maxIntoScalar(best + i, row + i, count - i);
+}
+
+float maxScoreNeon(const float *scores, int count) {
+    float32x4_t best = vdupq_n_f32(0.0f);
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        best = vmaxq_f32(best, vld1q_f32(scores + i));
+    }
+    float result = vmaxvq_f32(best);
+    for (; i < count; ++i) {
+        result = std::max(result, scores[i]);
+    }
+    return result;
+}
+
+#endif // DECODER_NEON
+
+MaxScoreFn chooseMaxScore() {
+    const CpuFeatures &cpu = CpuFeatures::host();
+#ifdef DECODER_X86
+    if (cpu.avx512) {
+        return maxScoreAvx512;
+    }
+    if (cpu.avx2) {
+        return maxScoreAvx2;
+    }
+#endif
+#ifdef DECODER_NEON
+    if (cpu.neon) {
+        return maxScoreNeon;
+    }
+#endif
+    Q_UNUSED(cpu);
+    return maxScoreScalar;
+}
+
+MaxIntoFn chooseMaxInto() {
+    const CpuFeatures &cpu = CpuFeatures::host();
+#ifdef DECODER_X86
+    if (cpu.avx512) {
+        return maxIntoAvx512;
+    }
+    if (cpu.avx2) {
+        return maxIntoAvx2;
+    }
+#endif
+#ifdef DECODER_NEON
+    if (cpu.neon) {
+        return maxIntoNeon;
+    }
+#endif
+    Q_UNUSED(cpu);
+    return maxIntoScalar;
+}
+
+} // namespace
+
+float YoloDecoder::maxScore(const float *scores, int count) {
+    static const MaxScoreFn fn = chooseMaxScore();
+    return fn(scores, count);
+}
+
+void YoloDecoder::maxInto(float *best, const float *row, int count) {
+    static const MaxIntoFn fn = chooseMaxInto();
+    fn(best, row, count);
+}
+
+int YoloDecoder::classOf(const float *scores, int count, float score) {
+    return static_cast<int>(std::find(scores, scores + count, score) - scores);
+}
+
+void YoloDecoder::decode(Layout layout, const cv::Mat &output, int batchIndex, int batchSize,
+                         const cv::Size &inputSize, const Preprocessor::Mapping &mapping, float threshold,
+                         DetectionCandidates &out) {
+    if (output.empty() || output.depth() != CV_32F) {
+        return;
+    }
+    if (layout == AnchorFree) {
+        decodeAnchorFree(output, batchIndex, mapping, threshold, out);
+    } else {
+        decodeRows(layout, output, batchIndex, batchSize, inputSize, mapping, threshold, out);
+    }
+}
+
+void YoloDecoder::decodeRows(Layout layout, const cv::Mat &output, int batchIndex, int batchSize,
+                             const cv::Size &inputSize, const Preprocessor::Mapping &mapping, float threshold,
+                             DetectionCandidates &out) {
+    const int cols = output.size[output.dims - 1];
+    const int rows = output.dims == 3 ? output.size[1] : output.rows / batchSize;
+    const int classes = cols - BOX_FIELDS;
+    if (classes <= 0) {
+        return;
+    }
+    const float *data = reinterpret_cast<const float *>(output.data)
+                        + static_cast<size_t>(batchIndex) * rows * cols;
+
+    // Region coordinates are relative to the input, ONNX ones in input
+    // pixels; undo the scale and letterbox to get region pixels
+    const bool relative = layout == Region;
+    const float toX = relative ? static_cast<float>(inputSize.width) : 1.0f;
+    const float toY = relative ? static_cast<float>(inputSize.height) : 1.0f;
+    const float toWidth = toX / mapping.scaleX;
+    const float toHeight = toY / mapping.scaleY;
+
+    for (int i = 0; i < rows; ++i) {
+        const float *detection = data + static_cast<size_t>(i) * cols;
+        const float objectness = detection[4];
+        if (!(objectness > threshold)) {
+            continue;
+        }
+
+        // Raw probabilities still need objectness folded in
+        const float *scores = detection + BOX_FIELDS;
+        float best = maxScore(scores, classes);
+        float score = relative ? best : best * objectness;
+        if (!(score > threshold)) {
+            continue;
+        }
+
+        float centerX = mapping.toRegionX(detection[0] * toX);
+        float centerY = mapping.toRegionY(detection[1] * toY);
+        float width = detection[2] * toWidth;
+        float height = detection[3] * toHeight;
+        out.add(centerX - width / 2, centerY - height / 2, width, height, score, classOf(scores, classes, best),
+                batchIndex);
+    }
+}
+
+void YoloDecoder::decodeAnchorFree(const cv::Mat &output, int batchIndex, const Preprocessor::Mapping &mapping,
+                                   float threshold, DetectionCandidates &out) {
+    // [N, 4 + classes, anchors], or [4 + classes, anchors] for one image
+    const int fields = output.dims == 3 ? output.size[1] : output.size[0];
+    const int anchors = output.size[output.dims - 1];
+    const int classes = fields - 4;
+    if (classes <= 0) {
+        return;
+    }
+    const float *data = reinterpret_cast<const float *>(output.data)
+                        + static_cast<size_t>(batchIndex) * fields * anchors;
+    auto field = [&](int f) { return data + static_cast<size_t>(f) * anchors; };
+
+    // Class rows are contiguous across anchors, so the best score of every
+    // anchor is a running elementwise max, one row at a time
+    thread_local std::vector<float> best;
+    best.assign(anchors, 0.0f);
+    for (int c = 0; c < classes; ++c) {
+        maxInto(best.data(), field(4 + c), anchors);
+    }
+
+    const float *cx = field(0);
+    const float *cy = field(1);
+    const float *w = field(2);
+    const float *h = field(3);
+    for (int a = 0; a < anchors; ++a) {
+        if (!(best[a] > threshold)) {
+            continue;
+        }
+        int classId = 0;
+        while (classId < classes - 1 && field(4 + classId)[a] != best[a]) {
+            ++classId;
+        }
+        float centerX = mapping.toRegionX(cx[a]);
+        float centerY = mapping.toRegionY(cy[a]);
+        float width = w[a] / mapping.scaleX;
+        float height = h[a] / mapping.scaleY;
+        out.add(centerX - width / 2, centerY - height / 2, width, height, best[a], classId, batchIndex);
+    }
+}
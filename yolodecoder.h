@@ -0,0 +1,110 @@
+#ifndef YOLODECODER_H
+#define YOLODECODER_H
+
+#include <opencv2/core.hpp>
+#include <vector>
+#include "preprocessor.h"
+
+// Decoded boxes as a structure of arrays, in region pixels. Reused across
+// frames; clear() keeps the capacity.
+struct DetectionCandidates {
+    std::vector<float> left;
+    std::vector<float> top;
+    std::vector<float> width;
+    std::vector<float> height;
+    std::vector<float> score;
+    std::vector<int> classId;
+    std::vector<int> image;     // Index in the batch
+
+    int size() const { return static_cast<int>(score.size()); }
+    bool empty() const { return score.empty(); }
+
+    void clear() {
+        left.clear();
+        top.clear();
+        width.clear();
+        height.clear();
+        score.clear();
+        classId.clear();
+        image.clear();
+    }
+
+    void reserve(int n) {
+        for (std::vector<float> *field : { &left, &top, &width, &height, &score }) {
+            field->reserve(n);
+        }
+        classId.reserve(n);
+        image.reserve(n);
+    }
+
+    void resize(int n) {
+        for (std::vector<float> *field : { &left, &top, &width, &height, &score }) {
+            field->resize(n);
+        }
+        classId.resize(n);
+        image.resize(n);
+    }
+
+    void add(float l, float t, float w, float h, float s, int c, int i) {
+        left.push_back(l);
+        top.push_back(t);
+        width.push_back(w);
+        height.push_back(h);
+        score.push_back(s);
+        classId.push_back(c);
+        image.push_back(i);
+    }
+};
+
+// Turns detector output into candidates, for three YOLO layouts:
+//
+// Region       Darknet region layers. Rows of cx, cy, w, h relative to the
+//              input, objectness, class scores already multiplied by
+//              objectness by OpenCV.
+// AnchorBased  YOLOv5/v7 style ONNX. Rows of cx, cy, w, h in input pixels,
+//              objectness, raw class probabilities.
+// AnchorFree   YOLOv8 style ONNX. Transposed: one row per field (cx, cy,
+//              w, h, then one per class) and one column per anchor, no
+//              objectness.
+//
+// With objectness no class can beat the threshold unless objectness does,
+// so rows are rejected on that one value before the class scores are
+// read, and survivors' best class comes from a vectorised max. Anchor-free
+// output is reduced a class row at a time across all anchors instead.
+class YoloDecoder
+{
+public:
+    enum Layout {
+        Region = 0,
+        AnchorBased,
+        AnchorFree
+    };
+
+    static constexpr int BOX_FIELDS = 5;    // cx, cy, w, h, objectness
+
+    // Appends the candidates of image batchIndex scoring above threshold,
+    // tagged with that index. Batches are a leading dimension, or for
+    // region layers also consecutive row blocks.
+    static void decode(Layout layout, const cv::Mat &output, int batchIndex, int batchSize,
+                       const cv::Size &inputSize, const Preprocessor::Mapping &mapping, float threshold,
+                       DetectionCandidates &out);
+
+    // Highest of count scores, never below 0. Uses AVX2, AVX-512 or NEON
+    // when the host has them; the result is identical to the scalar loop.
+    static float maxScore(const float *scores, int count);
+
+    // best[i] = max(best[i], row[i]), vectorised the same way
+    static void maxInto(float *best, const float *row, int count);
+
+    // First class with exactly that score
+    static int classOf(const float *scores, int count, float score);
+
+private:
+    static void decodeRows(Layout layout, const cv::Mat &output, int batchIndex, int batchSize,
+                           const cv::Size &inputSize, const Preprocessor::Mapping &mapping, float threshold,
+                           DetectionCandidates &out);
+    static void decodeAnchorFree(const cv::Mat &output, int batchIndex, const Preprocessor::Mapping &mapping,
+                                 float threshold, DetectionCandidates &out);
+};
+
+#endif // YOLODECODER_H